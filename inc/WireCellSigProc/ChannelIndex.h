@@ -0,0 +1,94 @@
+/** A ChannelIndex is an immutable, dense index of the channels of
+ * one IAnodePlane.
+ *
+ * Each channel is given an "OSP channel" index which runs
+ * contiguously first up the U, then V, then W channels, each plane in
+ * wire-in-plane order across the faces.  Per index, the WCT channel
+ * ident, the wire number in its plane, the plane index and the face
+ * ident are held in flat arrays.  Mapping an ident to its index is
+ * O(1) and does not touch the anode geometry.
+ *
+ * A channel with wires on both faces appears once per face and
+ * index() gives its last appearance.
+ *
+ * An index is built once per anode and shared by the components
+ * using it, see ChannelIndex::get().  It may be used from several
+ * threads.
+ */
+
+#ifndef WIRECELLSIGPROC_CHANNELINDEX
+#define WIRECELLSIGPROC_CHANNELINDEX
+
+#include "WireCellIface/IAnodePlane.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace WireCell {
+  namespace SigProc {
+
+    class ChannelIndex {
+    public:
+      typedef std::shared_ptr<const ChannelIndex> pointer;
+
+      // Return the index for the anode, building it on first use.
+      static pointer get(IAnodePlane::pointer anode);
+
+      explicit ChannelIndex(IAnodePlane::pointer anode);
+      ~ChannelIndex();
+
+      // Number of channels.
+      int size() const { return m_ident.size(); }
+
+      // Index of the channel ident or -1 if not in this anode.
+      int index(int ident) const {
+        if (m_sparse.empty()) {
+          const int off = ident - m_min_ident;
+          if (off < 0 || off >= (int)m_slot.size()) {
+            return -1;
+          }
+          return m_slot[off];
+        }
+        auto it = m_sparse.find(ident);
+        return it == m_sparse.end() ? -1 : it->second;
+      }
+
+      // Per index properties.  The index must be valid.
+      int ident(int index) const { return m_ident[index]; }
+      int wire(int index) const { return m_wire[index]; }
+      int plane(int index) const { return m_plane[index]; }
+      int face(int index) const { return m_face[index]; }
+
+      // The plane index of the channel ident or -1 if not in this
+      // anode.  Same as anode->resolve(ident).index() for known
+      // channels.
+      int plane_of(int ident) const {
+        const int ind = index(ident);
+        return ind < 0 ? -1 : m_plane[ind];
+      }
+
+      // Number of channels in a plane and the index of its first.
+      int nwires(int plane) const { return m_nwires[plane]; }
+      int first(int plane) const { return m_first[plane]; }
+
+    private:
+      std::vector<int> m_ident, m_wire, m_plane, m_face;
+      int m_nwires[3], m_first[3];
+
+      // ident to index.  Dense by ident-m_min_ident, with -1 for
+      // holes, unless the idents are too scattered in which case
+      // m_sparse is used.
+      int m_min_ident;
+      std::vector<int> m_slot;
+      std::unordered_map<int,int> m_sparse;
+    };
+
+  }
+}
+
+#endif
+// Local Variables:
+// mode: c++
+// c-basic-offset: 2
+// End:
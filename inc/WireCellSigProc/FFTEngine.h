@@ -0,0 +1,124 @@
+/** An FFTEngine performs the 2D (wire, time) transforms of the
+ * signal processing on arrays of one fixed shape.
+ *
+ * Unlike the free functions in WireCellUtil/Array.h an engine is
+ * made once per shape and keeps its FFT plans and scratch buffers
+ * for as long as it lives so repeated transforms do not re-plan nor
+ * reallocate.  Rows are indexed by wire and columns by tick so "row"
+ * transforms are along time and "column" transforms along wires.
+ *
+ * As rows are real the time spectra are Hermitian and the "half"
+ * methods keep only the nhalf() = ncols/2+1 non-redundant frequency
+ * columns.  Column transforms work on full or half arrays alike.
+ *
+ * An engine is not safe to use from more than one thread at a time.
+ * Use one per thread (eg, one per plane).
+ *
+ * Backends are looked up by name.  The "eigen" backend, built on
+ * Eigen's FFT, is always available and is used as the fallback for
+ * any unknown name.  The "eigen-blocked" backend gives the same
+ * results but does the whole-array time transforms, fwd_rows(),
+ * inv_rows() and fwd_rows_half(), on a wire-major copy of the array,
+ * made with cache-blocked transposes, which is faster for large
+ * planes.  Its single row and column transforms are those of
+ * "eigen".  In the OSP decon it so speeds up the forward pass only,
+ * as the inverse is done a row at a time.  Other backends may be
+ * added with declare().
+ */
+
+#ifndef WIRECELLSIGPROC_FFTENGINE
+#define WIRECELLSIGPROC_FFTENGINE
+
+#include "WireCellUtil/Array.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace WireCell {
+  namespace SigProc {
+
+    class FFTEngine {
+    public:
+      typedef std::shared_ptr<FFTEngine> pointer;
+      typedef std::function<pointer(int nrows, int ncols)> maker_t;
+
+      FFTEngine(int nrows, int ncols);
+      virtual ~FFTEngine();
+
+      int nrows() const { return m_nrows; }
+      int ncols() const { return m_ncols; }
+      int nhalf() const { return m_ncols/2 + 1; }
+
+      // The name of the backend implementing this engine.
+      virtual std::string backend() const = 0;
+
+      // Forward real to complex transform of each row.  The full
+      // (Hermitian) spectrum is written to out which is resized if
+      // needed.  Same as Array::dft_rc(in, 0).
+      virtual void fwd_rows(const Array::array_xxf& in, Array::array_xxc& out) = 0;
+
+      // Inverse transform of each row keeping the real part of the
+      // result in out which is resized if needed.  Same as
+      // Array::idft_cr(in, 0).
+      virtual void inv_rows(const Array::array_xxc& in, Array::array_xxf& out) = 0;
+
+      // As inv_rows() but for a single row spectrum of ncols()
+      // samples.  This lets a caller filter rows one at a time
+      // without a whole filtered array.
+      virtual void inv_row(const Eigen::VectorXcf& spec, Eigen::VectorXf& wave) = 0;
+
+      // As fwd_rows() but only the nhalf() non-redundant columns of
+      // each spectrum are written.
+      virtual void fwd_rows_half(const Array::array_xxf& in, Array::array_xxc& out) = 0;
+
+      // Complex to real inverse of a single row given only its
+      // nhalf() non-redundant frequencies.  A full spectrum is also
+      // accepted but only its first nhalf() are used.  The wave is
+      // resized to ncols().
+      virtual void inv_row_half(const Eigen::VectorXcf& spec, Eigen::VectorXf& wave) = 0;
+
+      // In-place forward complex transform of each column.  Same as
+      // arr = Array::dft_cc(arr, 1).  The array may have ncols() or
+      // nhalf() columns.
+      virtual void fwd_cols(Array::array_xxc& arr) = 0;
+
+      // In-place inverse complex transform of each column.  Same as
+      // arr = Array::idft_cc(arr, 1).  The array may have ncols() or
+      // nhalf() columns.
+      virtual void inv_cols(Array::array_xxc& arr) = 0;
+
+      // Make an engine of the named backend for the given shape.
+      // Unknown names fall back to "eigen".
+      static pointer make(const std::string& backend, int nrows, int ncols);
+
+      // Register a backend maker under a name, replacing any
+      // previous one of that name.
+      static void declare(const std::string& backend, maker_t maker);
+
+      // Return true if a backend of the name is registered.
+      static bool known(const std::string& backend);
+
+      // Names of all registered backends.
+      static std::vector<std::string> backends();
+
+    protected:
+
+      // Throw ValueError if the array is not of our shape.
+      void assert_shape(int nrows, int ncols, const char* what) const;
+
+      // As assert_shape() but also allow nhalf() columns.
+      void assert_shape_or_half(int nrows, int ncols, const char* what) const;
+
+      const int m_nrows, m_ncols;
+    };
+
+  }
+}
+
+#endif
+// Local Variables:
+// mode: c++
+// c-basic-offset: 2
+// End:
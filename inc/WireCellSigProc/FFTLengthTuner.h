@@ -0,0 +1,75 @@
+/** An FFTLengthTuner picks transform lengths by measurement.
+ *
+ * fft_best_length() guesses a fast length from its prime factors.
+ * The actual cost depends on the FFT backend and on the CPU, so the
+ * tuner instead times a real forward and inverse transform of each
+ * candidate length with an FFTEngine and picks the fastest.
+ *
+ * Timings are kept in a table keyed by length.  If a filename is
+ * given, the table is read from it on construction and written back
+ * whenever new lengths have been timed.  One file may hold tables
+ * for several "host/backend" keys:
+ *
+ *     { "myhost/eigen": { "9592": 1.2e-4, "9600": 9.1e-5, ... }, ... }
+ *
+ * Values are seconds per forward plus inverse transform.
+ *
+ * One tuner may be shared by several users, such as the per-anode
+ * OSPs of a multi-anode job, which then also share the file.  Its
+ * methods are serialized so lengths are timed one at a time and the
+ * file is written by one writer.
+ */
+
+#ifndef WIRECELLSIGPROC_FFTLENGTHTUNER
+#define WIRECELLSIGPROC_FFTLENGTHTUNER
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace WireCell {
+  namespace SigProc {
+
+    class FFTLengthTuner {
+    public:
+      // An empty filename means the table is not persisted.
+      FFTLengthTuner(const std::string& backend, const std::string& filename = "");
+      ~FFTLengthTuner();
+
+      // Return the fastest length in [nmin, nmax].  The candidates
+      // are the ends of the range and all lengths between with no
+      // prime factor above 7.  Lengths not yet in the table are timed
+      // and the result is then reported on stderr.
+      int best_length(int nmin, int nmax);
+
+      // Return the time for one length, timing it if needed.
+      double time(int nsamples);
+
+      // The candidates best_length() considers.
+      static std::vector<int> candidates(int nmin, int nmax);
+
+      // The table key, "hostname/backend".
+      const std::string& key() const { return m_key; }
+
+      // Write the table to the file, if any.
+      void save() const;
+
+    private:
+      std::string m_backend, m_filename, m_key;
+      std::map<int, double> m_times;
+      mutable std::mutex m_mutex;
+
+      double time_locked(int nsamples);
+      void save_locked() const;
+      double measure(int nsamples) const;
+    };
+
+  }
+}
+
+#endif
+// Local Variables:
+// mode: c++
+// c-basic-offset: 2
+// End:
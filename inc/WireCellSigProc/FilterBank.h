@@ -0,0 +1,76 @@
+/** A FilterBank holds IFilterWaveform components resolved up front
+ * and memoizes their sampled spectra.
+ *
+ * Filters are named by their (type, name) as given to the factory
+ * and are resolved to an integer handle with filter(), typically
+ * from a configure() method.  Handles for the element-wise product
+ * of two spectra may be made with product().  The hot path then
+ * calls spectrum(handle, nbins) which samples the spectrum on first
+ * use and afterwards returns a reference to the memoized copy
+ * without any factory lookup, sampling or allocation.
+ *
+ * spectrum() may be called from several threads and takes a lock
+ * each time, so keep what it returns rather than call it per item in
+ * a hot loop.  The references it returns stay valid until clear() or
+ * destruction.
+ */
+
+#ifndef WIRECELLSIGPROC_FILTERBANK
+#define WIRECELLSIGPROC_FILTERBANK
+
+#include "WireCellIface/IFilterWaveform.h"
+#include "WireCellUtil/Waveform.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace WireCell {
+  namespace SigProc {
+
+    class FilterBank {
+    public:
+      FilterBank();
+      ~FilterBank();
+
+      // Resolve a filter component and return its handle.  Asking
+      // again for the same filter returns the same handle.  Throws
+      // if no such component exists.
+      int filter(const std::string& type, const std::string& name);
+
+      // Return a handle for the element-wise product of the spectra
+      // of two handles.
+      int product(int handle1, int handle2);
+
+      // Return the spectrum for the handle sampled in nbins.
+      const Waveform::realseq_t& spectrum(int handle, int nbins);
+
+      // Forget all filters and spectra.  Handles become invalid.
+      void clear();
+
+    private:
+      struct Entry {
+        IFilterWaveform::pointer filter; // null for a product
+        int handle1, handle2;
+      };
+      std::vector<Entry> m_entries;
+      std::map<std::pair<std::string,std::string>, int> m_named;
+      std::map<std::pair<int,int>, int> m_products;
+
+      // memoized spectra by (handle, nbins)
+      std::map<std::pair<int,int>, Waveform::realseq_t> m_spectra;
+      std::mutex m_mutex;
+
+      // Call with m_mutex held.
+      const Waveform::realseq_t& spectrum_locked(int handle, int nbins);
+    };
+
+  }
+}
+
+#endif
+// Local Variables:
+// mode: c++
+// c-basic-offset: 2
+// End:
@@ -12,6 +12,8 @@
 #include "WireCellIface/IAnodePlane.h"
 
 #include "WireCellSigProc/Diagnostics.h"
+#include "WireCellSigProc/ChannelIndex.h"
+#include "WireCellSigProc/RobustStats.h"
 
 
 namespace WireCell {
@@ -22,12 +24,14 @@ namespace WireCell {
 	    
 
 	    bool Chirp_raise_baseline(WireCell::Waveform::realseq_t& sig, int bin1, int bin2);
-	    bool SignalFilter(WireCell::Waveform::realseq_t& sig);
-	    float CalcRMSWithFlags(const WireCell::Waveform::realseq_t& sig);
+	    // The RobustStats is the caller's scratch memory for the
+	    // percentiles, reused across the calls it makes.
+	    bool SignalFilter(WireCell::Waveform::realseq_t& sig, RobustStats& stats);
+	    float CalcRMSWithFlags(const WireCell::Waveform::realseq_t& sig, RobustStats& stats);
 	    bool RawAdapativeBaselineAlg(WireCell::Waveform::realseq_t& sig);
 
 	    bool RemoveFilterFlags(WireCell::Waveform::realseq_t& sig);
-	    bool NoisyFilterAlg(WireCell::Waveform::realseq_t& spec, float min_rms, float max_rms);
+	    bool NoisyFilterAlg(WireCell::Waveform::realseq_t& spec, float min_rms, float max_rms, RobustStats& stats);
 
 	    std::vector< std::vector<int> > SignalProtection(WireCell::Waveform::realseq_t& sig, const WireCell::Waveform::compseq_t& respec, int res_offset, int pad_f, int pad_b, float upper_decon_limit = 0.02, float decon_lf_cutoff = 0.08, float upper_adc_limit = 15, float protection_factor = 5.0, float min_adc_limit = 50);
 	    bool Subtract_WScaling(WireCell::IChannelFilter::channel_signals_t& chansig, const WireCell::Waveform::realseq_t& medians, const WireCell::Waveform::compseq_t& respec, int res_offset, std::vector< std::vector<int> >& rois, float upper_decon_limit1=0.08);
@@ -52,6 +56,7 @@ namespace WireCell {
             protected:
 		std::string m_anode_tn, m_noisedb_tn;
 		IAnodePlane::pointer m_anode;
+		ChannelIndex::pointer m_chindex;
 		IChannelNoiseDatabase::pointer m_noisedb;
             };
 
@@ -138,6 +143,7 @@ namespace WireCell {
 	    private:
 		std::string m_anode_tn;
 		IAnodePlane::pointer m_anode;
+		ChannelIndex::pointer m_chindex;
 		double m_threshold;
 		int m_window;
 		int m_nbins;
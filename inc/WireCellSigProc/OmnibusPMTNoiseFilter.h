@@ -5,6 +5,7 @@
 #include "WireCellIface/IConfigurable.h"
 #include "WireCellIface/IAnodePlane.h"
 #include "WireCellUtil/Waveform.h"
+#include "WireCellSigProc/ChannelIndex.h"
 
 
 
@@ -36,6 +37,7 @@ namespace WireCell {
       std::string m_intag, m_outtag;
       std::string m_anode_tn;
       IAnodePlane::pointer m_anode;
+      ChannelIndex::pointer m_chindex;
 
       int m_pad_window;
       int m_min_window_length;
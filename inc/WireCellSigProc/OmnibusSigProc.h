@@ -6,6 +6,16 @@
 #include "WireCellIface/IAnodePlane.h"
 #include "WireCellUtil/Waveform.h"
 #include "WireCellUtil/Array.h"
+#include "WireCellUtil/Response.h"
+#include "WireCellSigProc/ChannelIndex.h"
+#include "WireCellSigProc/FFTEngine.h"
+#include "WireCellSigProc/FFTLengthTuner.h"
+#include "WireCellSigProc/FilterBank.h"
+#include "WireCellSigProc/RobustStats.h"
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 namespace WireCell {
   namespace SigProc {
@@ -55,31 +65,128 @@ namespace WireCell {
       
     private:
 
-      // convert data into Eigen Matrix
-      void load_data(const input_pointer& in, int plane);
+      struct Context;
+
+      // The traces one plane contributes to the output frame.
+      // Indices are local to this plane's traces.
+      struct PlaneTraces {
+        ITrace::vector traces;
+        IFrame::trace_list_t wiener, gauss;
+        IFrame::trace_summary_t thresholds;
+      };
+
+      // run the full chain (load, decon, ROIs, save) for one plane,
+      // with out receiving the traces of each ROI parameter set
+      void process_plane(Context& ctx, int plane, std::vector<PlaneTraces>& out);
+
+      // sort the input traces and bad ranges into the planes' workspaces
+      void bucket_input(Context& ctx, const input_pointer& in);
+
+      // convert data into Eigen Matrix.  Column 0 holds tick tbin0,
+      // ticks outside the fft_nticks window are left zero.
+      void load_data(Context& ctx, int plane, int tbin0);
+
+      // An input trace or a bad range, in padded rows and in ticks
+      // from the start of the readout.  The trace samples belong to
+      // the input frame.
+      struct InTrace {
+        int row, tick;
+        const float* data;
+        int nticks;
+      };
+      struct BadRange {
+        int row, beg, end;
+      };
+
+      // One output of the 2D decon: a time filter spectrum, an
+      // optional alternative used for wires with a non-zero "choice"
+      // and the nwires x nticks array to receive the result.
+      struct DeconProduct {
+        const Waveform::realseq_t* filter;
+        const Waveform::realseq_t* alt_filter;
+        const std::vector<int>* choice; // per wire, may be null
+        Array::array_xxf* out;
+        bool restore;           // restore baseline of the result
+      };
+
+      // Per-plane working memory.  It is sized on first use and kept
+      // across frames so a steady state run does not reallocate.
+      struct PlaneWork {
+        // Each column is one tick, each row is indexed by an "OSP
+        // wire" number.  r_data holds the input, padded to the FFT
+        // size.  After decon_2D_init() c_data holds the deconvolved
+        // data as wires x time frequencies, keeping only the
+        // fft_nticks/2+1 non-redundant frequencies.
+        std::vector<InTrace> in_traces;
+        std::vector<BadRange> bad_ranges;
+        Array::array_xxf r_data;
+        Array::array_xxc c_data;
+        // The nwires x nticks ROI finding decon products.
+        Array::array_xxf r_tight, r_tighter, r_loose, r_refine;
+        // scratch
+        Eigen::VectorXcf spec;
+        Eigen::VectorXf wave;
+        // per thread scratch for row-parallel work
+        struct RowScratch {
+          Waveform::realseq_t signal, temp_signal;
+          RobustStats stats;
+        };
+        std::vector<RowScratch> rows;
+        std::vector<int> loose_choice;
+        std::vector<DeconProduct> products;
+        // Per wire, non-zero if it has any refined ROI in any set.
+        std::vector<int> roi_rows;
+        // The outputs of each ROI parameter set, see m_roi_sets.
+        // The decon fills those of the first, the others are copied.
+        struct SetWork {
+          // The nwires x nticks output products.
+          Array::array_xxf r_hits, r_charge;
+          Waveform::realseq_t charge;
+          // Per wire, the sorted, merged [begin,end) tick ranges of
+          // the refined ROIs.  Outside of these the outputs are zero.
+          std::vector<std::vector<std::pair<int,int> > > roi_ranges;
+          // Per wire, non-zero if it has any refined ROI.
+          std::vector<int> roi_rows;
+        };
+        std::vector<SetWork> sets;
+      };
 
       // deconvolution
-      void decon_2D_init(int plane); // main decon code 
-      void decon_2D_ROI_refine(int plane);
-      void decon_2D_tightROI(int plane);
-      void decon_2D_tighterROI(int plane); 
-      void decon_2D_looseROI(int plane);
-      void decon_2D_hits(int plane);
-      void decon_2D_charge(int plane);
+      void decon_2D_init(Context& ctx, int plane); // main decon code 
+      // filter, inverse transform, shift and crop each product in one
+      // pass over c_data.  Ticks [out_tick, out_tick+out_nticks) of
+      // each output come from the inverse starting at src_offset.
+      // If rows is given, wires where it is zero are set to zero
+      // instead.
+      void decon_2D_products(Context& ctx, int plane, const std::vector<DeconProduct>& products,
+                             int out_tick, int out_nticks, int src_offset,
+                             const std::vector<int>* rows = nullptr);
+      // make the full products, chunk by chunk if chunking is on,
+      // and restore their baselines as requested.  Unless chunking,
+      // load_data() and decon_2D_init() must have been called.
+      void decon_2D(Context& ctx, int plane, const std::vector<DeconProduct>& products,
+                    const std::vector<int>* rows = nullptr);
+      // the products used to find ROIs, tighter and loose and refine are induction only
+      void add_ROI_products(Context& ctx, int plane, std::vector<DeconProduct>& products);
+      // the wiener filtered "hits" and gaussian filtered "charge" outputs
+      void add_output_products(Context& ctx, int plane, std::vector<DeconProduct>& products);
       
-      // save data into the out frame and collect the indices
-      void save_data(ITrace::vector& itraces, IFrame::trace_list_t& indices, int plane,
+      // save data into the out frame and collect the indices.  If
+      // sparse, only the set's roi_ranges are scanned for signal.
+      void save_data(Context& ctx, PlaneWork::SetWork& sw,
+                     ITrace::vector& itraces, IFrame::trace_list_t& indices, int plane,
+                     const Array::array_xxf& r_data,
                      const std::vector<float>& perwire_rmses,
                      IFrame::trace_summary_t& threshold);
 
-      // initialize the overall response function ...
-      void init_overall_response(IFrame::pointer frame);
-
-      void restore_baseline(WireCell::Array::array_xxf& arr);
+      // rows where the optional mask is zero are known to be zero
+      // and are skipped.
+      void restore_baseline(WireCell::Array::array_xxf& arr, PlaneWork& work,
+                            const std::vector<int>* rows = nullptr);
 
       // This little struct is used to map between WCT channel idents
       // and internal OmnibusSigProc wire/channel numbers.  See
-      // m_channel_map and m_channel_range below.  
+      // m_osp_chans and m_channel_range below.
       struct OspChan {
         int channel;            // between 0 and nwire_u+nwire_v+nwire_w-1
         int wire;               // between 0 and nwire_{u,v,w,}-1 depending on plane
@@ -91,7 +198,7 @@ namespace WireCell {
 
       
       // find if neighbor channels hare masked.
-      bool masked_neighbors(const std::string& cmname, OspChan& ochan, int nnn);
+      bool masked_neighbors(const Context& ctx, const std::string& cmname, OspChan& ochan, int nnn) const;
       
       
       // Anode plane for geometry
@@ -104,45 +211,57 @@ namespace WireCell {
       double m_fine_time_offset; // must be positive, between 0-0.5 us, shift the response function to earlier time --> shift the deconvoluted signal to a later time
       double m_coarse_time_offset; // additional coarse time shift ...
       double m_intrinsic_time_offset;
-      int m_wire_shift[3];
       
-      // bins
+      // bins.  The period and nticks are only defaults for the
+      // configuration, the actual ones are taken from each frame.
       double m_period;
       int m_nticks;
       int m_fft_flag;
-      int m_fft_nwires[3], m_pad_nwires[3];
-      int m_fft_nticks, m_pad_nticks;
       
       // gain, shaping time, other applification factors
       double m_gain, m_shaping_time;
       double m_inter_gain, m_ADC_mV;
 
-      // some parameters for ROI creating
-      float m_th_factor_ind;
-      float m_th_factor_col;
-      int m_pad;
-      float m_asy ;
-      int m_rebin;
-      double m_l_factor;
-      double m_l_max_th;
-      double m_l_factor1;
-      int m_l_short_length;
-
-
-       // ROI_refinement
-      double m_r_th_factor;
-      double m_r_fake_signal_low_th;
-      double m_r_fake_signal_high_th;
-      double m_r_fake_signal_low_th_ind_factor;
-      double m_r_fake_signal_high_th_ind_factor;
-      int m_r_pad;
-      int m_r_break_roi_loop;
-      double m_r_th_peak;
-      double m_r_sep_peak;
-      double m_r_low_peak_sep_threshold_pre;
-      int m_r_max_npeaks;
-      double m_r_sigma;
-      double m_r_th_percent;
+      // The parameters for ROI creating and refinement.
+      struct RoiParams {
+        // ROI_formation
+        float th_factor_ind;
+        float th_factor_col;
+        int pad;
+        float asy;
+        int rebin;
+        double l_factor;
+        double l_max_th;
+        double l_factor1;
+        int l_short_length;
+
+        // ROI_refinement
+        double r_th_factor;
+        double r_fake_signal_low_th;
+        double r_fake_signal_high_th;
+        double r_fake_signal_low_th_ind_factor;
+        double r_fake_signal_high_th_ind_factor;
+        int r_pad;
+        int r_break_roi_loop;
+        double r_th_peak;
+        double r_sep_peak;
+        double r_low_peak_sep_threshold_pre;
+        int r_max_npeaks;
+        double r_sigma;
+        double r_th_percent;
+      };
+      RoiParams m_roi;
+      // read any ROI parameters in cfg into roi
+      static void configure_roi(const WireCell::Configuration& cfg, RoiParams& roi);
+
+      // The ROI parameter sets to run on the shared decon.  Normally
+      // just m_roi but in sweep mode one per "roi_sweep" entry, each
+      // with its outputs tagged with the suffix.
+      struct RoiSet {
+        std::string suffix;
+        RoiParams params;
+      };
+      std::vector<RoiSet> m_roi_sets;
 
       // fixme: this is apparently not used:
       // channel offset
@@ -162,25 +281,135 @@ namespace WireCell {
       // except that it is nonnegative.  
       int m_nwires[3];
 
-      // Need to go from WCT channel ident to {OSP channel, wire and plane}
-      std::map<int,OspChan> m_channel_map;
+      // Need to go from WCT channel ident to {OSP channel, wire and
+      // plane}.  The index gives the OSP channel of an ident which
+      // indexes m_osp_chans.
+      ChannelIndex::pointer m_chindex;
+      std::vector<OspChan> m_osp_chans;
 
       // Need to go from OSP plane to iterable {OSP channel an wire and WCT ident}
       std::vector<OspChan> m_channel_range[3];
 
-      // This is the input channel mask map but converted to OSP
-      // channel number indices.  See above.  This is NOT a direct
-      // copy from the IFrame.  It's reindexed by osp channel, not WCT
-      // channel ident!
-      Waveform::ChannelMaskMap m_cmm; 
+      // The wire-region averaged field response.  It is loaded on the
+      // first frame after each configure(), guarded by m_mutex.
+      bool m_have_fravg;
+      Response::Schema::FieldResponse m_fravg;
 
-      // Per-plane temporary working arrays.  Each column is one tick,
-      // each row is indexec by an "OSP wire" number
-      Array::array_xxf m_r_data;
-      Array::array_xxc m_c_data;
-      
-      //average overall responses
-      std::vector<Waveform::realseq_t> overall_resp[3];
+      // Everything which depends on the readout shape, the period
+      // and number of ticks of a frame, and not on its content: the
+      // FFT sizes, the shifts and the decon kernels.  Once made it is
+      // only read, so it is shared by all frames of that shape,
+      // including those processed concurrently.
+      struct Kernels {
+        double period;
+        int nticks;
+        // FFT window and the padding in ticks and, per plane, in wires
+        int fft_nticks, pad_nticks;
+        int fft_nwires[3], pad_nwires[3];
+        // See m_chunk_nticks.  A chunk_len of 0 means the readout is
+        // done in one FFT.
+        int chunk_margin_nticks, chunk_len;
+        // wires and ticks by which the decon output is delayed
+        int wire_shift[3];
+        int time_shift;
+
+        // Per-plane 2D decon kernel in (wire, time) frequency space:
+        // the wire filter divided by the 2D spectrum of the overall
+        // response.  Sized fft_nwires[plane] x (fft_nticks/2+1) as
+        // only the non-redundant time frequencies are kept.
+        Array::array_xxc decon_kernel[3];
+
+        // Per-plane ratio of nominal to per-channel electronics
+        // response spectra, one row per padded wire.  Empty unless
+        // m_per_chan_resp is set.  Sized as decon_kernel.
+        Array::array_xxc chan_corr[3];
+
+        // Per-plane time filters of m_plane_filters sampled in
+        // fft_nticks, copied here so the decon needs no lookup.
+        struct Spectra {
+          Waveform::realseq_t tight, tighter, loose, refine, hits, charge;
+        };
+        Spectra spectra[3];
+      };
+      typedef std::shared_ptr<const Kernels> kernels_pointer;
+
+      // Return the kernels for the shape, making them if it differs
+      // from that of the last call.  Safe to call concurrently.
+      kernels_pointer kernels(double period, int nticks);
+
+      // Make the overall response and from it the kernels for the
+      // shape set in kern.  Called with m_mutex held.
+      void init_overall_response(Kernels& kern);
+
+      // build the per-plane decon kernels from overall_resp
+      void init_decon_kernels(Kernels& kern, const std::vector<Waveform::realseq_t> overall_resp[3]);
+
+      // build the per-channel electronics corrections
+      void init_chan_corr(Kernels& kern);
+
+      // sample the time filters
+      void init_filter_spectra(Kernels& kern);
+
+      // The state of one call of operator().  A context is taken
+      // from a pool for each frame and returned after so the
+      // working memory is reused, and several frames may be
+      // processed at once, each in its own context.
+      struct Context {
+        kernels_pointer kern;
+
+        // The tbin of the start of the current readout.  Internal
+        // arrays and ROIs count ticks from here.
+        int tbin0;
+
+        // This is the input channel mask map but converted to OSP
+        // channel number indices.  See above.  This is NOT a direct
+        // copy from the IFrame.  It's reindexed by osp channel, not
+        // WCT channel ident!
+        Waveform::ChannelMaskMap cmm;
+
+        // The same with bin ranges in ticks from the start of the
+        // readout, tbin0, and clipped to the readout.  Ranges wholly
+        // outside it are dropped.  Filled by bucket_input(), see
+        // tick_cmm().
+        Waveform::ChannelMaskMap shifted_cmm;
+        const Waveform::ChannelMaskMap& tick_cmm() const {
+          return shifted_cmm;
+        }
+
+        // Per-plane working memory.  One per plane so the planes may
+        // be processed concurrently.
+        PlaneWork work[3];
+
+        // The per-plane engines made for the kernels' fft_nwires[plane]
+        // x fft_nticks shape.
+        FFTEngine::pointer fft[3];
+      };
+      std::unique_ptr<Context> acquire_context();
+      void release_context(std::unique_ptr<Context> ctx);
+
+      // Guards the kernels, the field response, the FFT length tuner
+      // and the context pool.
+      std::mutex m_mutex;
+      kernels_pointer m_kernels;
+      std::vector<std::unique_ptr<Context> > m_contexts;
+
+      // Name of the FFT backend.
+      std::string m_fft_backend;
+
+      // With m_fft_flag 2 the time length is tuned by measurement.
+      // The tuner is not thread safe and only used with m_mutex held.
+      std::string m_fft_table;
+      double m_fft_tune_slack;
+      std::shared_ptr<FFTLengthTuner> m_fft_tuner;
+      int fft_ticks_length(int nticks);
+
+      // Overlap-save chunking of long readouts.  Configured chunk
+      // size and margin (0 is off and derived, respectively).  The
+      // derived values are in Kernels.  Chunking bounds the FFT
+      // size, not the size of the products which span the readout.
+      int m_chunk_nticks, m_chunk_margin;
+      // The chunk length and margin last reported, under m_mutex.
+      std::pair<int,int> m_noted_chunks;
 
       // tag name for traces
       std::string m_wiener_tag;
@@ -192,7 +421,49 @@ namespace WireCell {
       // cover segments of waveforms which have non-zero signal
       // samples.
       bool m_sparse;
-      
+
+      // The products to make, "wiener" (with its thresholds) and
+      // "gauss", and the planes to make them for.  The decon, ROI
+      // application and saving of the others are skipped and their
+      // tags are left empty.
+      bool m_save_wiener, m_save_gauss;
+      bool m_do_plane[3];
+
+      // Number of threads over which the three planes, or the
+      // anodes in multi-anode mode, are spread.  The default of 1
+      // processes them serially.
+      int m_nthreads;
+
+      // Number of threads over which the rows of a plane are spread
+      // for the row-wise steps, such as baseline restoration and
+      // the tight and loose ROI finding.
+      int m_row_nthreads;
+
+      // Number of threads over which the ROI parameter sets of a
+      // plane are spread in sweep mode.
+      int m_sweep_nthreads;
+
+      // The filters, resolved at configure time, and the handles of
+      // those used for each plane.  See add_ROI_products()
+      // and add_output_products().
+      FilterBank m_filter_bank;
+      struct PlaneFilters {
+        int wire;               // applied in the wire dimension
+        int tight, tighter, loose, refine; // for ROI finding
+        int hits, charge;       // the wiener and gauss outputs
+      };
+      PlaneFilters m_plane_filters[3];
+
+      // Multi-anode mode.  If "anodes" is given, each anode is
+      // handled by a child OSP configured like this one and the
+      // children are spread over m_nthreads threads.
+      std::vector<std::string> m_anodes_tn;
+      std::vector<std::shared_ptr<OmnibusSigProc> > m_children;
+      // wct channel ident to index into m_children
+      std::unordered_map<int,int> m_child_of_channel;
+      void configure_children(const WireCell::Configuration& config);
+      bool process_children(const input_pointer& in, output_pointer& out);
+
     };
   }
 }
@@ -0,0 +1,54 @@
+/** Robust statistics of a span of samples.
+ *
+ * The percentiles are those of Waveform::percentile_binned(): the
+ * samples are histogrammed in as many bins as there are samples,
+ * spanning their minimum to maximum, and a percentile is the lower
+ * edge of the bin where the cumulative count first passes it.  The
+ * results are identical but the histogram is made once for any
+ * number of percentiles and its memory is kept for the next call.
+ *
+ * A RobustStats object holds the scratch memory so use one per
+ * thread.
+ */
+
+#ifndef WIRECELLSIGPROC_ROBUSTSTATS
+#define WIRECELLSIGPROC_ROBUSTSTATS
+
+#include <vector>
+
+namespace WireCell {
+  namespace SigProc {
+
+    class RobustStats {
+    public:
+
+      // Set out[i] to the fracs[i] percentile of the n samples for
+      // i in [0,nfracs).  With no samples all are zero.
+      void percentiles(const float* data, int n, const float* fracs, float* out, int nfracs);
+
+      float percentile(const float* data, int n, float frac) {
+        float ret = 0;
+        percentiles(data, n, &frac, &ret, 1);
+        return ret;
+      }
+      float median(const float* data, int n) {
+        return percentile(data, n, 0.5);
+      }
+
+      // The RMS estimated from the spread of the 16% and 84%
+      // percentiles about the median, sqrt((d_lo^2 + d_hi^2)/2).  If
+      // given, the median is also returned.
+      float percentile_rms(const float* data, int n, float* median = nullptr);
+
+    private:
+      std::vector<int> m_bins, m_hist;
+    };
+
+  }
+}
+
+#endif
+// Local Variables:
+// mode: c++
+// c-basic-offset: 2
+// End:
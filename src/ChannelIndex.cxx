@@ -0,0 +1,109 @@
+#include "WireCellSigProc/ChannelIndex.h"
+
+#include "WireCellUtil/Exceptions.h"
+#include "WireCellUtil/String.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+
+using namespace WireCell;
+using namespace WireCell::SigProc;
+
+ChannelIndex::pointer ChannelIndex::get(IAnodePlane::pointer anode)
+{
+  // An entry is only good while both its anode and its index live.
+  // A new anode may take the address of a destroyed one so entries
+  // of destroyed anodes are dropped before looking.
+  struct Entry {
+    std::weak_ptr<const IAnodePlane> anode;
+    std::weak_ptr<const ChannelIndex> index;
+  };
+  static std::mutex mutex;
+  static std::map<const IAnodePlane*, Entry> cache;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto it = cache.begin(); it != cache.end();) {
+    if (it->second.anode.expired() || it->second.index.expired()) {
+      it = cache.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+  Entry& entry = cache[anode.get()];
+  pointer ret = entry.index.lock();
+  if (!ret) {
+    ret = std::make_shared<const ChannelIndex>(anode);
+    entry.anode = anode;
+    entry.index = ret;
+  }
+  return ret;
+}
+
+ChannelIndex::ChannelIndex(IAnodePlane::pointer anode)
+  : m_min_ident(0)
+{
+  // Gather plane-major, then face, then wire-in-plane order.
+  IChannel::vector plane_channels[3];
+  std::vector<int> plane_faces[3];
+  for (auto face : anode->faces()) {
+    if (!face) { // A null face means one sided AnodePlane.
+      continue;  // Can be "back" or "front" face.
+    }
+    for (auto plane: face->planes()) {
+      const int plane_index = plane->planeid().index();
+      if (plane_index < 0 || plane_index > 2) {
+        THROW(ValueError() << errmsg{String::format("ChannelIndex: bad plane index %d", plane_index)});
+      }
+      // These IChannel vectors are ordered in same order as wire-in-plane.
+      const auto& ichans = plane->channels();
+      auto& pchans = plane_channels[plane_index];
+      pchans.insert(pchans.end(), ichans.begin(), ichans.end());
+      plane_faces[plane_index].resize(pchans.size(), face->ident());
+    }
+  }
+
+  for (int iplane = 0; iplane < 3; ++iplane) {
+    m_first[iplane] = m_ident.size();
+    m_nwires[iplane] = plane_channels[iplane].size();
+    int iwire = 0;
+    for (auto ichan : plane_channels[iplane]) {
+      m_ident.push_back(ichan->ident());
+      m_wire.push_back(iwire);
+      m_plane.push_back(iplane);
+      m_face.push_back(plane_faces[iplane][iwire]);
+      ++iwire;
+    }
+  }
+
+  const int nchans = m_ident.size();
+  if (!nchans) {
+    return;
+  }
+  const auto mm = std::minmax_element(m_ident.begin(), m_ident.end());
+  m_min_ident = *mm.first;
+  const long span = (long)*mm.second - m_min_ident + 1;
+  // Idents are usually near contiguous.  Do not let a few outliers
+  // blow up the dense table.
+  if (span <= 4L*nchans + 1024) {
+    m_slot.assign(span, -1);
+    for (int ind = 0; ind < nchans; ++ind) {
+      m_slot[m_ident[ind] - m_min_ident] = ind;
+    }
+  }
+  else {
+    for (int ind = 0; ind < nchans; ++ind) {
+      m_sparse[m_ident[ind]] = ind;
+    }
+  }
+}
+
+ChannelIndex::~ChannelIndex()
+{
+}
+
+// Local Variables:
+// mode: c++
+// c-basic-offset: 2
+// End:
@@ -1,4 +1,5 @@
 #include "WireCellSigProc/Derivations.h"
+#include "WireCellSigProc/RobustStats.h"
 
 #include <iostream>
 
@@ -50,8 +51,10 @@ WireCell::Waveform::realseq_t Derivations::CalcMedian(const WireCell::IChannelFi
     }      
   
     WireCell::Waveform::realseq_t medians(nbins);
+    WireCell::Waveform::realseq_t temp;
+    RobustStats stats;
     for (int ibin=0;ibin!=nbins;ibin++){
-	WireCell::Waveform::realseq_t temp;
+	temp.clear();
 	for (int ich=0; ich!=nchannel; ich++) {
             const float cont = content.at(ich*nbins + ibin);
 	    if (fabs(cont) < 5 * max_rms && 
@@ -60,7 +63,7 @@ WireCell::Waveform::realseq_t Derivations::CalcMedian(const WireCell::IChannelFi
 	    } 
 	}
 	if (temp.size()>0){
-	    medians.at(ibin)=WireCell::Waveform::median_binned(temp);
+	    medians.at(ibin)=stats.median(temp.data(), temp.size());
 	}
         else{
 	    medians.at(ibin)=0;
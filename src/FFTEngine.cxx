@@ -0,0 +1,277 @@
+#include "WireCellSigProc/FFTEngine.h"
+
+#include "WireCellUtil/Exceptions.h"
+#include "WireCellUtil/String.h"
+
+#include <unsupported/Eigen/FFT>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <mutex>
+
+using namespace WireCell;
+using namespace WireCell::SigProc;
+
+namespace {
+
+  // The Eigen FFT object caches its plans keyed by transform size
+  // so holding one per engine keeps them across calls.  Rows are
+  // strided in the column-major arrays so they go through scratch
+  // vectors.  Columns are contiguous but Eigen's FFT does not work
+  // in place so they go through a scratch vector as well.  The
+  // transforms are the same calls as made by Array::dft_*() so
+  // results are identical.
+  class EigenFFTEngine : public FFTEngine {
+  public:
+    EigenFFTEngine(int nrows, int ncols)
+      : FFTEngine(nrows, ncols)
+      , m_rtime(ncols)
+      , m_ctime(ncols)
+      , m_cfreq(ncols)
+      , m_cwire(nrows)
+    {
+    }
+    virtual ~EigenFFTEngine() {}
+
+    virtual std::string backend() const { return "eigen"; }
+
+    virtual void fwd_rows(const Array::array_xxf& in, Array::array_xxc& out) {
+      assert_shape(in.rows(), in.cols(), "fwd_rows");
+      out.resize(m_nrows, m_ncols);
+      for (int irow = 0; irow < m_nrows; ++irow) {
+        m_rtime = in.row(irow);
+        m_fft.fwd(m_cfreq.data(), m_rtime.data(), m_ncols);
+        out.row(irow) = m_cfreq.transpose();
+      }
+    }
+
+    virtual void inv_rows(const Array::array_xxc& in, Array::array_xxf& out) {
+      assert_shape(in.rows(), in.cols(), "inv_rows");
+      out.resize(m_nrows, m_ncols);
+      for (int irow = 0; irow < m_nrows; ++irow) {
+        m_cfreq = in.row(irow).transpose();
+        m_fft.inv(m_ctime.data(), m_cfreq.data(), m_ncols);
+        out.row(irow) = m_ctime.real().transpose();
+      }
+    }
+
+    virtual void inv_row(const Eigen::VectorXcf& spec, Eigen::VectorXf& wave) {
+      assert_shape(m_nrows, spec.size(), "inv_row");
+      m_fft.inv(m_ctime.data(), spec.data(), m_ncols);
+      wave = m_ctime.real();
+    }
+
+    virtual void fwd_rows_half(const Array::array_xxf& in, Array::array_xxc& out) {
+      assert_shape(in.rows(), in.cols(), "fwd_rows_half");
+      const int nhalf = this->nhalf();
+      out.resize(m_nrows, nhalf);
+      for (int irow = 0; irow < m_nrows; ++irow) {
+        m_rtime = in.row(irow);
+        m_fft.fwd(m_cfreq.data(), m_rtime.data(), m_ncols);
+        out.row(irow) = m_cfreq.head(nhalf).transpose();
+      }
+    }
+
+    virtual void inv_row_half(const Eigen::VectorXcf& spec, Eigen::VectorXf& wave) {
+      assert_shape_or_half(m_nrows, spec.size(), "inv_row_half");
+      wave.resize(m_ncols);
+      // The real inverse only reads the first nhalf() frequencies.
+      m_fft.inv(wave.data(), spec.data(), m_ncols);
+    }
+
+    virtual void fwd_cols(Array::array_xxc& arr) {
+      assert_shape_or_half(arr.rows(), arr.cols(), "fwd_cols");
+      for (int icol = 0; icol < arr.cols(); ++icol) {
+        m_cwire = arr.col(icol);
+        m_fft.fwd(&arr(0,icol), m_cwire.data(), m_nrows);
+      }
+    }
+
+    virtual void inv_cols(Array::array_xxc& arr) {
+      assert_shape_or_half(arr.rows(), arr.cols(), "inv_cols");
+      for (int icol = 0; icol < arr.cols(); ++icol) {
+        m_cwire = arr.col(icol);
+        m_fft.inv(&arr(0,icol), m_cwire.data(), m_nrows);
+      }
+    }
+
+  protected:
+    Eigen::FFT<float> m_fft;
+    Eigen::VectorXf m_rtime;
+    Eigen::VectorXcf m_ctime, m_cfreq, m_cwire;
+  };
+
+  // Copy the transpose of src into dst a tile at a time so that both
+  // the strided reads and writes stay in cache.
+  template<typename Src, typename Dst>
+  void blocked_transpose(const Src& src, Dst& dst)
+  {
+    const int block = 64;
+    const int nrows = src.rows(), ncols = src.cols();
+    dst.resize(ncols, nrows);
+    for (int jbeg = 0; jbeg < ncols; jbeg += block) {
+      const int jend = std::min(jbeg + block, ncols);
+      for (int ibeg = 0; ibeg < nrows; ibeg += block) {
+        const int iend = std::min(ibeg + block, nrows);
+        for (int j = jbeg; j < jend; ++j) {
+          for (int i = ibeg; i < iend; ++i) {
+            dst(j,i) = src(i,j);
+          }
+        }
+      }
+    }
+  }
+
+  // The arrays are column major so the time samples of a wire are
+  // strided by the number of wires.  This engine moves whole arrays
+  // to wire-major (time contiguous) buffers with blocked transposes
+  // so that each time transform reads and writes contiguous memory
+  // instead of gathering one row at a time.  The column (wire)
+  // transforms are contiguous already and inherited.  So are the
+  // single row inverses, inv_row() and inv_row_half(), whose caller
+  // already gives contiguous vectors.  Results are identical to the
+  // "eigen" backend.
+  class BlockedEigenFFTEngine : public EigenFFTEngine {
+  public:
+    BlockedEigenFFTEngine(int nrows, int ncols)
+      : EigenFFTEngine(nrows, ncols)
+    {
+      // writes only the first nhalf() frequencies, same values
+      m_hfft.SetFlag(m_hfft.HalfSpectrum);
+    }
+    virtual ~BlockedEigenFFTEngine() {}
+
+    virtual std::string backend() const { return "eigen-blocked"; }
+
+    virtual void fwd_rows(const Array::array_xxf& in, Array::array_xxc& out) {
+      assert_shape(in.rows(), in.cols(), "fwd_rows");
+      blocked_transpose(in, m_rbuf);
+      m_cbuf.resize(m_ncols, m_nrows);
+      for (int irow = 0; irow < m_nrows; ++irow) {
+        m_fft.fwd(&m_cbuf(0,irow), &m_rbuf(0,irow), m_ncols);
+      }
+      blocked_transpose(m_cbuf, out);
+    }
+
+    virtual void inv_rows(const Array::array_xxc& in, Array::array_xxf& out) {
+      assert_shape(in.rows(), in.cols(), "inv_rows");
+      blocked_transpose(in, m_cbuf);
+      m_rbuf.resize(m_ncols, m_nrows);
+      for (int irow = 0; irow < m_nrows; ++irow) {
+        m_fft.inv(m_ctime.data(), &m_cbuf(0,irow), m_ncols);
+        m_rbuf.col(irow) = m_ctime.real();
+      }
+      blocked_transpose(m_rbuf, out);
+    }
+
+    virtual void fwd_rows_half(const Array::array_xxf& in, Array::array_xxc& out) {
+      assert_shape(in.rows(), in.cols(), "fwd_rows_half");
+      blocked_transpose(in, m_rbuf);
+      m_cbuf.resize(nhalf(), m_nrows);
+      for (int irow = 0; irow < m_nrows; ++irow) {
+        m_hfft.fwd(&m_cbuf(0,irow), &m_rbuf(0,irow), m_ncols);
+      }
+      blocked_transpose(m_cbuf, out);
+    }
+
+  private:
+    Eigen::FFT<float> m_hfft;
+    // wire-major buffers, one column per wire
+    Array::array_xxf m_rbuf;
+    Array::array_xxc m_cbuf;
+  };
+
+  typedef std::map<std::string, FFTEngine::maker_t> registry_t;
+
+  std::mutex& registry_mutex()
+  {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  // Call with registry_mutex() held.
+  registry_t& registry()
+  {
+    static registry_t reg{
+      {"eigen", [](int nrows, int ncols) {
+          return FFTEngine::pointer(new EigenFFTEngine(nrows, ncols));
+        }},
+      {"eigen-blocked", [](int nrows, int ncols) {
+          return FFTEngine::pointer(new BlockedEigenFFTEngine(nrows, ncols));
+        }}
+    };
+    return reg;
+  }
+}
+
+FFTEngine::FFTEngine(int nrows, int ncols)
+  : m_nrows(nrows)
+  , m_ncols(ncols)
+{
+}
+
+FFTEngine::~FFTEngine()
+{
+}
+
+void FFTEngine::assert_shape(int nrows, int ncols, const char* what) const
+{
+  if (nrows == m_nrows && ncols == m_ncols) {
+    return;
+  }
+  THROW(ValueError() << errmsg{String::format("FFTEngine::%s: array is %dx%d, engine is %dx%d",
+                                              what, nrows, ncols, m_nrows, m_ncols)});
+}
+
+void FFTEngine::assert_shape_or_half(int nrows, int ncols, const char* what) const
+{
+  if (nrows == m_nrows && ncols == nhalf()) {
+    return;
+  }
+  assert_shape(nrows, ncols, what);
+}
+
+FFTEngine::pointer FFTEngine::make(const std::string& backend, int nrows, int ncols)
+{
+  maker_t maker;
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    auto& reg = registry();
+    auto it = reg.find(backend);
+    if (it == reg.end()) {
+      std::cerr << "FFTEngine: unknown backend \"" << backend << "\", using \"eigen\"\n";
+      it = reg.find("eigen");
+    }
+    maker = it->second;
+  }
+  return maker(nrows, ncols);
+}
+
+void FFTEngine::declare(const std::string& backend, maker_t maker)
+{
+  std::lock_guard<std::mutex> lock(registry_mutex());
+  registry()[backend] = maker;
+}
+
+bool FFTEngine::known(const std::string& backend)
+{
+  std::lock_guard<std::mutex> lock(registry_mutex());
+  auto& reg = registry();
+  return reg.find(backend) != reg.end();
+}
+
+std::vector<std::string> FFTEngine::backends()
+{
+  std::lock_guard<std::mutex> lock(registry_mutex());
+  std::vector<std::string> ret;
+  for (const auto& it : registry()) {
+    ret.push_back(it.first);
+  }
+  return ret;
+}
+
+// Local Variables:
+// mode: c++
+// c-basic-offset: 2
+// End:
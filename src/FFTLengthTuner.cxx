@@ -0,0 +1,168 @@
+#include "WireCellSigProc/FFTLengthTuner.h"
+#include "WireCellSigProc/FFTEngine.h"
+
+#include "WireCellUtil/Persist.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+using namespace WireCell;
+using namespace WireCell::SigProc;
+
+static std::string host_name()
+{
+  char buf[256] = {0};
+  if (gethostname(buf, sizeof(buf)-1) != 0 || !buf[0]) {
+    return "unknown";
+  }
+  return buf;
+}
+
+FFTLengthTuner::FFTLengthTuner(const std::string& backend, const std::string& filename)
+  : m_backend(backend)
+  , m_filename(filename)
+  , m_key(host_name() + "/" + backend)
+{
+  if (m_filename.empty() || !Persist::exists(m_filename)) {
+    return;
+  }
+  auto top = Persist::load(m_filename);
+  auto jtab = top[m_key];
+  for (auto it = jtab.begin(); it != jtab.end(); ++it) {
+    m_times[std::stoi(it.key().asString())] = (*it).asDouble();
+  }
+  std::cerr << "FFTLengthTuner: " << m_times.size() << " lengths for "
+            << m_key << " from " << m_filename << "\n";
+}
+
+FFTLengthTuner::~FFTLengthTuner()
+{
+}
+
+std::vector<int> FFTLengthTuner::candidates(int nmin, int nmax)
+{
+  std::vector<int> ret;
+  for (int n = nmin; n <= nmax; ++n) {
+    int rem = n;
+    for (int p : {2, 3, 5, 7}) {
+      while (rem > 1 && rem % p == 0) {
+        rem /= p;
+      }
+    }
+    if (n == nmin || n == nmax || rem == 1) {
+      ret.push_back(n);
+    }
+  }
+  return ret;
+}
+
+int FFTLengthTuner::best_length(int nmin, int nmax)
+{
+  if (nmax <= nmin) {
+    return nmin;
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const size_t nknown = m_times.size();
+  int best = nmin;
+  double best_time = -1;
+  for (int n : candidates(nmin, nmax)) {
+    const double t = time_locked(n);
+    if (best_time < 0 || t < best_time) {
+      best = n;
+      best_time = t;
+    }
+  }
+  // only report what was not known before, later calls are lookups
+  if (m_times.size() != nknown) {
+    std::cerr << "FFTLengthTuner: " << m_key << " best length in [" << nmin << ","
+              << nmax << "] is " << best << " after timing "
+              << m_times.size() - nknown << " lengths\n";
+    save_locked();
+  }
+  return best;
+}
+
+double FFTLengthTuner::time(int nsamples)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return time_locked(nsamples);
+}
+
+double FFTLengthTuner::time_locked(int nsamples)
+{
+  auto it = m_times.find(nsamples);
+  if (it != m_times.end()) {
+    return it->second;
+  }
+  const double t = measure(nsamples);
+  m_times[nsamples] = t;
+  return t;
+}
+
+double FFTLengthTuner::measure(int nsamples) const
+{
+  typedef std::chrono::steady_clock clock;
+  auto engine = FFTEngine::make(m_backend, 1, nsamples);
+  const Array::array_xxf wave = Array::array_xxf::Random(1, nsamples);
+  Array::array_xxc spec;
+  Eigen::VectorXcf row;
+  Eigen::VectorXf back;
+
+  // first call makes the plans
+  engine->fwd_rows_half(wave, spec);
+
+  // repeat to get a few ms per trial, keep the best of a few trials
+  int nreps = 1;
+  double best = -1;
+  for (int itrial = 0; itrial < 5; ++itrial) {
+    const auto t0 = clock::now();
+    for (int irep = 0; irep < nreps; ++irep) {
+      engine->fwd_rows_half(wave, spec);
+      row = spec.row(0).transpose();
+      engine->inv_row_half(row, back);
+    }
+    const double dt = std::chrono::duration<double>(clock::now() - t0).count();
+    if (dt < 2e-3 && nreps < (1<<20)) {
+      nreps *= 2;
+      --itrial;               // too short to trust, try again
+      continue;
+    }
+    const double per = dt / nreps;
+    if (best < 0 || per < best) {
+      best = per;
+    }
+  }
+  return best;
+}
+
+void FFTLengthTuner::save() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  save_locked();
+}
+
+void FFTLengthTuner::save_locked() const
+{
+  if (m_filename.empty()) {
+    return;
+  }
+  // keep the tables of other hosts and backends
+  Json::Value top = Json::objectValue;
+  if (Persist::exists(m_filename)) {
+    top = Persist::load(m_filename);
+  }
+  Json::Value jtab = Json::objectValue;
+  for (const auto& it : m_times) {
+    jtab[std::to_string(it.first)] = it.second;
+  }
+  top[m_key] = jtab;
+  Persist::dump(m_filename, top, true);
+}
+
+// Local Variables:
+// mode: c++
+// c-basic-offset: 2
+// End:
@@ -0,0 +1,98 @@
+#include "WireCellSigProc/FilterBank.h"
+
+#include "WireCellUtil/NamedFactory.h"
+#include "WireCellUtil/Exceptions.h"
+#include "WireCellUtil/String.h"
+
+using namespace WireCell;
+using namespace WireCell::SigProc;
+
+FilterBank::FilterBank()
+{
+}
+
+FilterBank::~FilterBank()
+{
+}
+
+int FilterBank::filter(const std::string& type, const std::string& name)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const auto key = std::make_pair(type, name);
+  auto it = m_named.find(key);
+  if (it != m_named.end()) {
+    return it->second;
+  }
+  // this throws if not found
+  auto filt = Factory::find<IFilterWaveform>(type, name);
+  const int handle = m_entries.size();
+  m_entries.push_back(Entry{filt, -1, -1});
+  m_named[key] = handle;
+  return handle;
+}
+
+int FilterBank::product(int handle1, int handle2)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const int nentries = m_entries.size();
+  if (handle1 < 0 || handle1 >= nentries || handle2 < 0 || handle2 >= nentries) {
+    THROW(ValueError() << errmsg{String::format("FilterBank: bad handles %d, %d", handle1, handle2)});
+  }
+  const auto key = std::make_pair(handle1, handle2);
+  auto it = m_products.find(key);
+  if (it != m_products.end()) {
+    return it->second;
+  }
+  const int handle = m_entries.size();
+  m_entries.push_back(Entry{nullptr, handle1, handle2});
+  m_products[key] = handle;
+  return handle;
+}
+
+const Waveform::realseq_t& FilterBank::spectrum(int handle, int nbins)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return spectrum_locked(handle, nbins);
+}
+
+const Waveform::realseq_t& FilterBank::spectrum_locked(int handle, int nbins)
+{
+  const auto key = std::make_pair(handle, nbins);
+  auto it = m_spectra.find(key);
+  if (it != m_spectra.end()) {
+    return it->second;
+  }
+
+  if (handle < 0 || handle >= (int)m_entries.size()) {
+    THROW(ValueError() << errmsg{String::format("FilterBank: bad handle %d", handle)});
+  }
+  const Entry& entry = m_entries[handle];
+
+  Waveform::realseq_t spec;
+  if (entry.filter) {
+    spec = entry.filter->filter_waveform(nbins);
+  }
+  else {
+    // std::map nodes are stable so these stay valid as we insert.
+    spec = spectrum_locked(entry.handle1, nbins);
+    const Waveform::realseq_t& other = spectrum_locked(entry.handle2, nbins);
+    for (size_t ind=0; ind != spec.size(); ++ind) {
+      spec.at(ind) *= other.at(ind);
+    }
+  }
+  return m_spectra[key] = spec;
+}
+
+void FilterBank::clear()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries.clear();
+  m_named.clear();
+  m_products.clear();
+  m_spectra.clear();
+}
+
+// Local Variables:
+// mode: c++
+// c-basic-offset: 2
+// End:
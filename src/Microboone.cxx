@@ -4,6 +4,7 @@
  
 #include "WireCellSigProc/Microboone.h"
 #include "WireCellSigProc/Derivations.h"
+#include "WireCellSigProc/RobustStats.h"
 
 #include "WireCellUtil/NamedFactory.h"
 
@@ -538,9 +539,9 @@ std::vector< std::vector<int> > Microboone::SignalProtection(WireCell::Waveform:
     return rois;
 }
 
-bool Microboone::NoisyFilterAlg(WireCell::Waveform::realseq_t& sig, float min_rms, float max_rms)
+bool Microboone::NoisyFilterAlg(WireCell::Waveform::realseq_t& sig, float min_rms, float max_rms, RobustStats& stats)
 {
-    const double rmsVal = Microboone::CalcRMSWithFlags(sig);
+    const double rmsVal = Microboone::CalcRMSWithFlags(sig, stats);
 
     //std::cout << rmsVal << std::endl;
     
@@ -621,7 +622,7 @@ bool Microboone::Chirp_raise_baseline(WireCell::Waveform::realseq_t& sig, int bi
     return true;
 }
 
-float Microboone::CalcRMSWithFlags(const WireCell::Waveform::realseq_t& sig)
+float Microboone::CalcRMSWithFlags(const WireCell::Waveform::realseq_t& sig, RobustStats& stats)
 {
     float theRMS = 0.0;
     //int waveformSize = sig.size();
@@ -630,26 +631,20 @@ float Microboone::CalcRMSWithFlags(const WireCell::Waveform::realseq_t& sig)
     for (size_t i=0;i!=sig.size();i++){
 	if (sig.at(i) < 4096) temp.push_back(sig.at(i));
     }
-    float par[3];
     if (temp.size()>0) {
-	par[0] = WireCell::Waveform::percentile_binned(temp,0.5 - 0.34);
-	par[1] = WireCell::Waveform::percentile_binned(temp,0.5);
-	par[2] = WireCell::Waveform::percentile_binned(temp,0.5 + 0.34);
-    
-	//    std::cout << par[0] << " " << par[1] << " " << par[2] << std::endl;
-
-	theRMS = sqrt((pow(par[2]-par[1],2)+pow(par[1]-par[0],2))/2.);
+	// the three percentiles from one histogram
+	theRMS = stats.percentile_rms(temp.data(), temp.size());
     }
   
     return theRMS;
 }
 
-bool Microboone::SignalFilter(WireCell::Waveform::realseq_t& sig)
+bool Microboone::SignalFilter(WireCell::Waveform::realseq_t& sig, RobustStats& stats)
 {
     const double sigFactor = 4.0;
     const int padBins = 8;
   
-    float rmsVal = Microboone::CalcRMSWithFlags(sig);
+    float rmsVal = Microboone::CalcRMSWithFlags(sig, stats);
     float sigThreshold = sigFactor*rmsVal;
   
     float ADCval;
@@ -853,6 +848,7 @@ void Microboone::ConfigFilterBase::configure(const WireCell::Configuration& cfg)
 {
     m_anode_tn = get(cfg, "anode", m_anode_tn);
     m_anode = Factory::find_tn<IAnodePlane>(m_anode_tn);
+    m_chindex = ChannelIndex::get(m_anode);
     m_noisedb_tn = get(cfg, "noisedb", m_noisedb_tn);
     m_noisedb = Factory::find_tn<IChannelNoiseDatabase>(m_noisedb_tn);
     //std::cerr << "ConfigFilterBase: \n" << cfg << "\n";
@@ -992,8 +988,7 @@ WireCell::Waveform::ChannelMaskMap Microboone::OneChannelNoise::apply(int ch, si
     if (is_chirp) {
       ret["chirp"][ch].push_back(chirped_bins);
        
-      auto wpid = m_anode->resolve(ch);      
-      const int iplane = wpid.index();
+      const int iplane = m_chindex->plane_of(ch);
 
       if (iplane!=2){ // not collection
 	  if (chirped_bins.first>0 || chirped_bins.second<int(signal.size())){
@@ -1060,7 +1055,9 @@ WireCell::Waveform::ChannelMaskMap Microboone::OneChannelNoise::apply(int ch, si
 	    temp_signal.at(i) = temp.first;
 	}
     }
-    baseline = WireCell::Waveform::median_binned(temp_signal);
+    // scratch for this channel's percentiles, also used below
+    RobustStats stats;
+    baseline = stats.median(temp_signal.data(), temp_signal.size());
     //correct baseline
     WireCell::Waveform::increase(signal, baseline *(-1));
 
@@ -1072,7 +1069,7 @@ WireCell::Waveform::ChannelMaskMap Microboone::OneChannelNoise::apply(int ch, si
     // Now do adaptive baseline for the chirping channels
     if (is_chirp) {
 	Microboone::Chirp_raise_baseline(signal,chirped_bins.first, chirped_bins.second);
-	Microboone::SignalFilter(signal);
+	Microboone::SignalFilter(signal, stats);
 	Microboone::RawAdapativeBaselineAlg(signal);
     }
     // Now do the adaptive baseline for the bad RC channels
@@ -1082,20 +1079,19 @@ WireCell::Waveform::ChannelMaskMap Microboone::OneChannelNoise::apply(int ch, si
 	temp_chirped_bins.first = 0;
 	temp_chirped_bins.second = signal.size();
 
-	auto wpid = m_anode->resolve(ch);
-	const int iplane = wpid.index();
+	const int iplane = m_chindex->plane_of(ch);
 	if (iplane!=2) {        // not collection
 	    ret["lf_noisy"][ch].push_back(temp_chirped_bins);
 	    //std::cout << "Partial " << ch << std::endl;
 	}
-	Microboone::SignalFilter(signal);
+	Microboone::SignalFilter(signal, stats);
 	Microboone::RawAdapativeBaselineAlg(signal);
     }
 
     // std::cerr << "OneChannelNoise: "<<ch<<" before SignalFilter: sigsum="<<Waveform::sum(signal)<<"\n";
 
     // Identify the Noisy channels ... 
-    Microboone::SignalFilter(signal);
+    Microboone::SignalFilter(signal, stats);
 
     //
     const float min_rms = m_noisedb->min_rms_cut(ch);
@@ -1103,7 +1099,7 @@ WireCell::Waveform::ChannelMaskMap Microboone::OneChannelNoise::apply(int ch, si
     
     //std::cerr << "OneChannelNoise: "<<ch<< " RMS:["<<min_rms<<","<<max_rms<<"] sigsum="<<Waveform::sum(signal)<<"\n";
 
-    bool is_noisy = Microboone::NoisyFilterAlg(signal,min_rms,max_rms);
+    bool is_noisy = Microboone::NoisyFilterAlg(signal,min_rms,max_rms,stats);
     Microboone::RemoveFilterFlags(signal);
 
     if (is_noisy) {
@@ -1316,6 +1312,7 @@ void Microboone::OneChannelStatus::configure(const WireCell::Configuration& cfg)
     if (!m_anode) {
         THROW(KeyError() << errmsg{"failed to get IAnodePlane: " + m_anode_tn});
     }
+    m_chindex = ChannelIndex::get(m_anode);
     //std::cerr << "OneChannelStatus: \n" << cfg << "\n";
 }
 WireCell::Configuration Microboone::OneChannelStatus::default_configuration() const
@@ -1340,8 +1337,7 @@ WireCell::Waveform::ChannelMaskMap Microboone::OneChannelStatus::apply(channel_s
 WireCell::Waveform::ChannelMaskMap Microboone::OneChannelStatus::apply(int ch, signal_t& signal) const
 {
     WireCell::Waveform::ChannelMaskMap ret;
-    auto wpid = m_anode->resolve(ch);
-    const int iplane = wpid.index();
+    const int iplane = m_chindex->plane_of(ch);
     if (iplane!=2){ // not collection
 	//std::cout << ch << std::endl;
 	if (ID_lf_noisy(signal)){
@@ -1364,9 +1360,13 @@ bool Microboone::OneChannelStatus::ID_lf_noisy(signal_t& sig) const{
     //double mean = results.first;
     //double rms = results.second;
 
-    double mean = Waveform::percentile_binned(sig,0.5);
-    double val1 = Waveform::percentile_binned(sig,0.5-0.34);
-    double val2 = Waveform::percentile_binned(sig,0.5+0.34);
+    const float fracs[3] = {0.5, 0.5-0.34, 0.5+0.34};
+    float vals[3];
+    RobustStats stats;
+    stats.percentiles(sig.data(), sig.size(), fracs, vals, 3);
+    double mean = vals[0];
+    double val1 = vals[1];
+    double val2 = vals[2];
     double rms = sqrt((pow(val1-mean,2)+pow(val2-mean,2))/2.);
     
     double valid = 0 ;
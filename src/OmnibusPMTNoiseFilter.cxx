@@ -49,6 +49,7 @@ void OmnibusPMTNoiseFilter::configure(const WireCell::Configuration& config)
   if (!m_anode) {
     THROW(KeyError() << errmsg{"failed to get IAnodePlane: " + m_anode_tn});
   }
+  m_chindex = ChannelIndex::get(m_anode);
 
   m_pad_window = get(config,"pad_window", m_pad_window);
   m_min_window_length = get(config,"min_window_length",m_min_window_length);
@@ -94,8 +95,7 @@ bool OmnibusPMTNoiseFilter::operator()(const input_pointer& in, output_pointer&
   for (auto trace : traces) {
     int ch = trace->channel();
 
-    auto wpid = m_anode->resolve(ch);      
-    const int iplane = wpid.index();
+    const int iplane = m_chindex->plane_of(ch);
 
     Waveform::realseq_t signal=trace->charge();
     std::pair<double,double> results = Derivations::CalcRMS(signal);
@@ -9,11 +9,11 @@
 #include "WireCellIface/SimpleTrace.h"
 
 #include "WireCellIface/IFieldResponse.h"
-#include "WireCellIface/IFilterWaveform.h"
 #include "WireCellIface/IChannelResponse.h"
 
 #include "ROI_formation.h"
 #include "ROI_refinement.h"
+#include "Parallel.h"
 
 #include "WireCellUtil/NamedFactory.h"
 
@@ -72,35 +72,51 @@ OmnibusSigProc::OmnibusSigProc(const std::string& anode_tn,
   , m_shaping_time(shaping_time)
   , m_inter_gain(inter_gain)
   , m_ADC_mV(ADC_mV)
-  , m_th_factor_ind(th_factor_ind)
-  , m_th_factor_col(th_factor_col)
-  , m_pad(pad)
-  , m_asy(asy)
-  , m_rebin(rebin)
-  , m_l_factor(l_factor)
-  , m_l_max_th(l_max_th)
-  , m_l_factor1(l_factor1)
-  , m_l_short_length(l_short_length)
-  , m_r_th_factor(r_th_factor)
-  , m_r_fake_signal_low_th(r_fake_signal_low_th)
-  , m_r_fake_signal_high_th(r_fake_signal_high_th)
-  , m_r_fake_signal_low_th_ind_factor(r_fake_signal_low_th_ind_factor)
-  , m_r_fake_signal_high_th_ind_factor(r_fake_signal_high_th_ind_factor)
-  , m_r_pad(r_pad)
-  , m_r_break_roi_loop(r_break_roi_loop)
-  , m_r_th_peak(r_th_peak)
-  , m_r_sep_peak(r_sep_peak)
-  , m_r_low_peak_sep_threshold_pre(r_low_peak_sep_threshold_pre)
-  , m_r_max_npeaks(r_max_npeaks)
-  , m_r_sigma(r_sigma)
-  , m_r_th_percent(r_th_percent)
   , m_charge_ch_offset(charge_ch_offset)
+  , m_have_fravg(false)
+  , m_fft_backend("eigen")
+  , m_fft_tune_slack(0.1)
+  , m_chunk_nticks(0)
+  , m_chunk_margin(0)
+  , m_noted_chunks(0, 0)
   , m_wiener_tag(wiener_tag)
   , m_wiener_threshold_tag(wiener_threshold_tag)
   , m_gauss_tag(gauss_tag) 
   , m_frame_tag("sigproc")
   , m_sparse(false)
+  , m_save_wiener(true)
+  , m_save_gauss(true)
+  , m_nthreads(1)
+  , m_row_nthreads(1)
+  , m_sweep_nthreads(1)
 {
+  m_roi.th_factor_ind = th_factor_ind;
+  m_roi.th_factor_col = th_factor_col;
+  m_roi.pad = pad;
+  m_roi.asy = asy;
+  m_roi.rebin = rebin;
+  m_roi.l_factor = l_factor;
+  m_roi.l_max_th = l_max_th;
+  m_roi.l_factor1 = l_factor1;
+  m_roi.l_short_length = l_short_length;
+  m_roi.r_th_factor = r_th_factor;
+  m_roi.r_fake_signal_low_th = r_fake_signal_low_th;
+  m_roi.r_fake_signal_high_th = r_fake_signal_high_th;
+  m_roi.r_fake_signal_low_th_ind_factor = r_fake_signal_low_th_ind_factor;
+  m_roi.r_fake_signal_high_th_ind_factor = r_fake_signal_high_th_ind_factor;
+  m_roi.r_pad = r_pad;
+  m_roi.r_break_roi_loop = r_break_roi_loop;
+  m_roi.r_th_peak = r_th_peak;
+  m_roi.r_sep_peak = r_sep_peak;
+  m_roi.r_low_peak_sep_threshold_pre = r_low_peak_sep_threshold_pre;
+  m_roi.r_max_npeaks = r_max_npeaks;
+  m_roi.r_sigma = r_sigma;
+  m_roi.r_th_percent = r_th_percent;
+
+  for (int iplane = 0; iplane < 3; ++iplane) {
+    m_do_plane[iplane] = true;
+  }
+
   // get wires for each plane
 
  
@@ -123,14 +139,67 @@ std::string WireCell::SigProc::OmnibusSigProc::OspChan::str() const
 void OmnibusSigProc::configure(const WireCell::Configuration& config)
 {
   m_sparse = get(config, "sparse", false);
+  if (!config["products"].isNull()) {
+    m_save_wiener = m_save_gauss = false;
+    for (auto jprod : config["products"]) {
+      const std::string prod = jprod.asString();
+      if (prod == "wiener") {
+        m_save_wiener = true;
+      }
+      else if (prod == "gauss") {
+        m_save_gauss = true;
+      }
+      else {
+        THROW(ValueError() << errmsg{"OmnibusSigProc: unknown product: " + prod});
+      }
+    }
+    if (!m_save_wiener && !m_save_gauss) {
+      THROW(ValueError() << errmsg{"OmnibusSigProc: no products selected"});
+    }
+  }
+  if (!config["planes"].isNull()) {
+    for (int iplane = 0; iplane < 3; ++iplane) {
+      m_do_plane[iplane] = false;
+    }
+    for (auto jplane : config["planes"]) {
+      const int iplane = jplane.asInt();
+      if (iplane < 0 || iplane > 2) {
+        THROW(ValueError() << errmsg{String::format("OmnibusSigProc: bad plane index: %d", iplane)});
+      }
+      m_do_plane[iplane] = true;
+    }
+  }
+  m_nthreads = get(config, "nthreads", m_nthreads);
+  m_row_nthreads = get(config, "row_nthreads", m_row_nthreads);
 
   m_fine_time_offset = get(config,"ftoffset",m_fine_time_offset);
   m_coarse_time_offset = get(config,"ctoffset",m_coarse_time_offset);
   m_anode_tn = get(config, "anode", m_anode_tn);
+  m_anodes_tn.clear();
+  for (auto janode : config["anodes"]) {
+    m_anodes_tn.push_back(janode.asString());
+  }
   m_nticks = get(config,"nticks",m_nticks);
   m_period = get(config,"period",m_period);
 
   m_fft_flag = get(config,"fft_flag",m_fft_flag);
+  m_fft_backend = get(config,"fft_backend",m_fft_backend);
+  m_fft_table = get(config,"fft_table",m_fft_table);
+  m_fft_tune_slack = get(config,"fft_tune_slack",m_fft_tune_slack);
+  m_chunk_nticks = get(config,"chunk_nticks",m_chunk_nticks);
+  m_chunk_margin = get(config,"chunk_margin",m_chunk_margin);
+  {
+    // rebuild kernels and engines with the new config
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_fft_tuner = nullptr;
+    if (m_fft_flag == 2) {
+      m_fft_tuner = std::make_shared<FFTLengthTuner>(m_fft_backend, m_fft_table);
+    }
+    m_kernels = nullptr;
+    m_have_fravg = false;       // the field response may have changed
+    m_noted_chunks = std::make_pair(0, 0);
+    m_contexts.clear();
+  }
   
   m_gain = get(config,"gain",m_gain);
   m_shaping_time = get(config,"shaping",m_shaping_time);
@@ -140,30 +209,25 @@ void OmnibusSigProc::configure(const WireCell::Configuration& config)
   m_per_chan_resp = get(config, "per_chan_resp", m_per_chan_resp);
   m_field_response = get(config, "field_response", m_field_response);
 
-  m_th_factor_ind = get(config,"troi_ind_th_factor",m_th_factor_ind);
-  m_th_factor_col = get(config,"troi_col_th_factor",m_th_factor_col);
-  m_pad = get(config,"troi_pad",m_pad);
-  m_asy = get(config,"troi_asy",m_asy);
-  m_rebin = get(config,"lroi_rebin",m_rebin);
-  m_l_factor = get(config,"lroi_th_factor",m_l_factor);
-  m_l_max_th = get(config,"lroi_max_th",m_l_max_th);
-  m_l_factor1 = get(config,"lori_th_factor1",m_l_factor1);
-  m_l_short_length = get(config,"lroi_short_length",m_l_short_length);
-
-
-  m_r_th_factor = get(config,"r_th_factor",m_r_th_factor);
-  m_r_fake_signal_low_th = get(config,"r_fake_signal_low_th",m_r_fake_signal_low_th);
-  m_r_fake_signal_high_th = get(config,"r_fake_signal_high_th",m_r_fake_signal_high_th);
-  m_r_fake_signal_low_th_ind_factor = get(config,"r_fake_signal_low_th_ind_factor",m_r_fake_signal_low_th_ind_factor);
-  m_r_fake_signal_high_th_ind_factor = get(config,"r_fake_signal_high_th_ind_factor",m_r_fake_signal_high_th_ind_factor);
-  m_r_pad = get(config,"r_pad",m_r_pad);
-  m_r_break_roi_loop = get(config,"r_break_roi_loop",m_r_break_roi_loop);
-  m_r_th_peak = get(config,"r_th_peak",m_r_th_peak);
-  m_r_sep_peak = get(config,"r_sep_peak",m_r_sep_peak);
-  m_r_low_peak_sep_threshold_pre = get(config,"r_low_peak_sep_threshold_pre",m_r_low_peak_sep_threshold_pre);
-  m_r_max_npeaks = get(config,"r_max_npeaks",m_r_max_npeaks);
-  m_r_sigma = get(config,"r_sigma",m_r_sigma);
-  m_r_th_percent = get(config,"r_th_percent",m_r_th_percent);
+  configure_roi(config, m_roi);
+
+  // In sweep mode each entry is a parameter set overriding the above
+  // and the name appended to its output tags.
+  m_roi_sets.clear();
+  for (auto jset : config["roi_sweep"]) {
+    RoiSet rs{"_" + get<std::string>(jset, "name", std::to_string(m_roi_sets.size())), m_roi};
+    configure_roi(jset, rs.params);
+    for (const auto& other : m_roi_sets) {
+      if (other.suffix == rs.suffix) {
+        THROW(ValueError() << errmsg{"OmnibusSigProc: ROI sweep names not unique: " + rs.suffix});
+      }
+    }
+    m_roi_sets.push_back(rs);
+  }
+  if (m_roi_sets.empty()) {
+    m_roi_sets.push_back(RoiSet{"", m_roi});
+  }
+  m_sweep_nthreads = get(config, "sweep_nthreads", m_sweep_nthreads);
 
   m_charge_ch_offset = get(config,"charge_ch_offset",m_charge_ch_offset);
   
@@ -173,45 +237,58 @@ void OmnibusSigProc::configure(const WireCell::Configuration& config)
   m_frame_tag = get(config,"frame_tag",m_frame_tag);  
 
 
+  m_children.clear();
+  m_child_of_channel.clear();
+  if (!m_anodes_tn.empty()) {
+    configure_children(config);
+    return;
+  }
+
   // this throws if not found
   m_anode = Factory::find_tn<IAnodePlane>(m_anode_tn);
 
-  // Build up the channel map.  The OSP channel must run contiguously
-  // first up the U, then V, then W "wires".  Ie, face-major order,
-  // but we have plane-major order so make a temporary collection.
-  IChannel::vector plane_channels[3];
-  for (auto face : m_anode->faces()) {
-    if (!face) { // A null face means one sided AnodePlane.  
-      continue;  // Can be "back" or "front" face.
-    }
-    for (auto plane: face->planes()) {
-      int plane_index = plane->planeid().index();
-      auto& pchans = plane_channels[plane_index];
-      // These IChannel vectors are ordered in same order as wire-in-plane.
-      const auto& ichans = plane->channels();
-      // Append
-      pchans.reserve(pchans.size() + ichans.size());
-      pchans.insert(pchans.end(), ichans.begin(), ichans.end());
-      std::cerr << "a" << m_anode->ident() << " "
-                << "f" << face->ident() << " "
-                << "p" << plane->ident() << " "
-                << "c" << ichans.front()->ident() << " -> c" << ichans.back()->ident() << ", "
-                << "i" << ichans.front()->index() << " -> i" << ichans.back()->index() << "\n";
+  // Resolve all the filters now so the frame processing needs no
+  // factory lookups.  This throws if any are not found.
+  m_filter_bank.clear();
+  {
+    const std::string uvw = "UVW";
+    const int roi_tight_lf = m_filter_bank.filter("LfFilter", "ROI_tight_lf");
+    const int roi_tighter_lf = m_filter_bank.filter("LfFilter", "ROI_tighter_lf");
+    const int roi_loose_lf = m_filter_bank.filter("LfFilter", "ROI_loose_lf");
+    const int gaus_wide = m_filter_bank.filter("HfFilter", "Gaus_wide");
+    for (int iplane = 0; iplane < 3; ++iplane) {
+      PlaneFilters& pf = m_plane_filters[iplane];
+      const int wiener_tight = m_filter_bank.filter("HfFilter", std::string("Wiener_tight_") + uvw[iplane]);
+      pf.wire = m_filter_bank.filter("HfFilter", iplane < 2 ? "Wire_ind" : "Wire_col");
+      pf.refine = wiener_tight;
+      pf.hits = m_filter_bank.filter("HfFilter", std::string("Wiener_wide_") + uvw[iplane]);
+      pf.charge = gaus_wide;
+      if (iplane < 2) {         // induction also cuts low frequencies
+        pf.tight = m_filter_bank.product(wiener_tight, roi_tight_lf);
+        pf.tighter = m_filter_bank.product(wiener_tight, roi_tighter_lf);
+        pf.loose = m_filter_bank.product(wiener_tight, roi_loose_lf);
+      }
+      else {
+        pf.tight = pf.tighter = pf.loose = wiener_tight;
+      }
     }
   }
 
-  int osp_channel_number = 0;
+  // Build up the channel map.  The OSP channel must run contiguously
+  // first up the U, then V, then W "wires" which is the order of the
+  // shared channel index.
+  m_chindex = ChannelIndex::get(m_anode);
+  m_osp_chans.clear();
   for (int iplane = 0; iplane < 3; ++iplane) {
-    m_nwires[iplane] = plane_channels[iplane].size();
-    int osp_wire_number = 0;
-    for (auto ichan : plane_channels[iplane]) {
-      const int wct_chan_ident = ichan->ident();
-      OspChan och(osp_channel_number, osp_wire_number, iplane, wct_chan_ident);
-      m_channel_map[wct_chan_ident] = och; // we could save some space by storing
-      m_channel_range[iplane].push_back(och);// wct ident here instead of a whole och.
-      ++osp_wire_number;
-      ++osp_channel_number;
-    }
+    m_channel_range[iplane].clear();
+  }
+  for (int ind = 0; ind < m_chindex->size(); ++ind) {
+    OspChan och(ind, m_chindex->wire(ind), m_chindex->plane(ind), m_chindex->ident(ind));
+    m_osp_chans.push_back(och);
+    m_channel_range[och.plane].push_back(och);
+  }
+  for (int iplane = 0; iplane < 3; ++iplane) {
+    m_nwires[iplane] = m_chindex->nwires(iplane);
     // std::cerr << iplane << ": och:["
     //           << m_channel_range[iplane].front().str()
     //           << " -> "
@@ -221,16 +298,69 @@ void OmnibusSigProc::configure(const WireCell::Configuration& config)
 
 }
 
+void OmnibusSigProc::configure_roi(const WireCell::Configuration& cfg, RoiParams& roi)
+{
+  roi.th_factor_ind = get(cfg,"troi_ind_th_factor",roi.th_factor_ind);
+  roi.th_factor_col = get(cfg,"troi_col_th_factor",roi.th_factor_col);
+  roi.pad = get(cfg,"troi_pad",roi.pad);
+  roi.asy = get(cfg,"troi_asy",roi.asy);
+  roi.rebin = get(cfg,"lroi_rebin",roi.rebin);
+  roi.l_factor = get(cfg,"lroi_th_factor",roi.l_factor);
+  roi.l_max_th = get(cfg,"lroi_max_th",roi.l_max_th);
+  roi.l_factor1 = get(cfg,"lori_th_factor1",roi.l_factor1);
+  roi.l_short_length = get(cfg,"lroi_short_length",roi.l_short_length);
+
+
+  roi.r_th_factor = get(cfg,"r_th_factor",roi.r_th_factor);
+  roi.r_fake_signal_low_th = get(cfg,"r_fake_signal_low_th",roi.r_fake_signal_low_th);
+  roi.r_fake_signal_high_th = get(cfg,"r_fake_signal_high_th",roi.r_fake_signal_high_th);
+  roi.r_fake_signal_low_th_ind_factor = get(cfg,"r_fake_signal_low_th_ind_factor",roi.r_fake_signal_low_th_ind_factor);
+  roi.r_fake_signal_high_th_ind_factor = get(cfg,"r_fake_signal_high_th_ind_factor",roi.r_fake_signal_high_th_ind_factor);
+  roi.r_pad = get(cfg,"r_pad",roi.r_pad);
+  roi.r_break_roi_loop = get(cfg,"r_break_roi_loop",roi.r_break_roi_loop);
+  roi.r_th_peak = get(cfg,"r_th_peak",roi.r_th_peak);
+  roi.r_sep_peak = get(cfg,"r_sep_peak",roi.r_sep_peak);
+  roi.r_low_peak_sep_threshold_pre = get(cfg,"r_low_peak_sep_threshold_pre",roi.r_low_peak_sep_threshold_pre);
+  roi.r_max_npeaks = get(cfg,"r_max_npeaks",roi.r_max_npeaks);
+  roi.r_sigma = get(cfg,"r_sigma",roi.r_sigma);
+  roi.r_th_percent = get(cfg,"r_th_percent",roi.r_th_percent);
+}
+
 WireCell::Configuration OmnibusSigProc::default_configuration() const
 {
   Configuration cfg;
   cfg["anode"] = m_anode_tn;
+  // If not empty, a list of anodes each processed as if by its own
+  // OSP with the rest of this configuration, "anode" is ignored.
+  // The anodes run in parallel on "nthreads" threads and the output
+  // is one merged frame.  In either mode the output masks are those
+  // of the input for the channels handled, keyed by channel ident.
+  cfg["anodes"] = Json::arrayValue;
   cfg["ftoffset"] = m_fine_time_offset;
   cfg["ctoffset"] = m_coarse_time_offset;
   cfg["nticks"] = m_nticks;
   cfg["period"] = m_period;
 
+  // 0: FFT the readout as is, 1: pad to fft_best_length(), 2: pad
+  // in time to the length measured fastest, see FFTLengthTuner.
   cfg["fft_flag"] = m_fft_flag;
+  // FFT implementation, "eigen" is always available and the fallback.
+  // "eigen-blocked" only speeds up the forward time transforms.
+  cfg["fft_backend"] = m_fft_backend;
+  // With fft_flag 2, lengths up to this fraction longer than the
+  // readout are tried and the timings are kept in the fft_table
+  // file, if given.
+  cfg["fft_table"] = m_fft_table;
+  cfg["fft_tune_slack"] = m_fft_tune_slack;
+  // If positive, deconvolve readouts longer than this many ticks in
+  // overlapping chunks of about this size.  The margin on each side
+  // of a chunk is chunk_margin ticks or, if not positive, the length
+  // of the response.  This only shortens the FFTs and the response
+  // and kernels which follow their size.  The products and ROI
+  // finding still span the whole readout so the memory used still
+  // grows with its length.
+  cfg["chunk_nticks"] = m_chunk_nticks;
+  cfg["chunk_margin"] = m_chunk_margin;
   
   cfg["gain"] = m_gain;
   cfg["shaping"] = m_shaping_time;
@@ -240,29 +370,38 @@ WireCell::Configuration OmnibusSigProc::default_configuration() const
   cfg["per_chan_resp"] = m_per_chan_resp;
   cfg["field_response"] = m_field_response;
 
-  cfg["troi_ind_th_factor"] = m_th_factor_ind;
-  cfg["troi_col_th_factor"] = m_th_factor_col;
-  cfg["troi_pad"] = m_pad;
-  cfg["troi_asy"] = m_asy;
-  cfg["lroi_rebin"] = m_rebin; 
-  cfg["lroi_th_factor"] = m_l_factor;
-  cfg["lroi_max_th"] = m_l_max_th;
-  cfg["lori_th_factor1"] = m_l_factor1;
-  cfg["lroi_short_length"] = m_l_short_length; 
-
-  cfg["r_th_factor"] = m_r_th_factor;
-  cfg["r_fake_signal_low_th"] = m_r_fake_signal_low_th;
-  cfg["r_fake_signal_high_th"] = m_r_fake_signal_high_th;
-  cfg["r_fake_signal_low_th_ind_factor"] = m_r_fake_signal_low_th_ind_factor;
-  cfg["r_fake_signal_high_th_ind_factor"] = m_r_fake_signal_high_th_ind_factor;
-  cfg["r_pad"] = m_r_pad;
-  cfg["r_break_roi_loop"] = m_r_break_roi_loop;
-  cfg["r_th_peak"] = m_r_th_peak;
-  cfg["r_sep_peak"] = m_r_sep_peak;
-  cfg["r_low_peak_sep_threshold_pre"] = m_r_low_peak_sep_threshold_pre;
-  cfg["r_max_npeaks"] = m_r_max_npeaks;
-  cfg["r_sigma"] = m_r_sigma;
-  cfg["r_th_precent"] = m_r_th_percent;
+  cfg["troi_ind_th_factor"] = m_roi.th_factor_ind;
+  cfg["troi_col_th_factor"] = m_roi.th_factor_col;
+  cfg["troi_pad"] = m_roi.pad;
+  cfg["troi_asy"] = m_roi.asy;
+  cfg["lroi_rebin"] = m_roi.rebin; 
+  cfg["lroi_th_factor"] = m_roi.l_factor;
+  cfg["lroi_max_th"] = m_roi.l_max_th;
+  cfg["lori_th_factor1"] = m_roi.l_factor1;
+  cfg["lroi_short_length"] = m_roi.l_short_length; 
+
+  cfg["r_th_factor"] = m_roi.r_th_factor;
+  cfg["r_fake_signal_low_th"] = m_roi.r_fake_signal_low_th;
+  cfg["r_fake_signal_high_th"] = m_roi.r_fake_signal_high_th;
+  cfg["r_fake_signal_low_th_ind_factor"] = m_roi.r_fake_signal_low_th_ind_factor;
+  cfg["r_fake_signal_high_th_ind_factor"] = m_roi.r_fake_signal_high_th_ind_factor;
+  cfg["r_pad"] = m_roi.r_pad;
+  cfg["r_break_roi_loop"] = m_roi.r_break_roi_loop;
+  cfg["r_th_peak"] = m_roi.r_th_peak;
+  cfg["r_sep_peak"] = m_roi.r_sep_peak;
+  cfg["r_low_peak_sep_threshold_pre"] = m_roi.r_low_peak_sep_threshold_pre;
+  cfg["r_max_npeaks"] = m_roi.r_max_npeaks;
+  cfg["r_sigma"] = m_roi.r_sigma;
+  cfg["r_th_precent"] = m_roi.r_th_percent;
+
+  // If not empty, a list of objects each giving some of the above
+  // troi_*, lroi_* and r_* parameters and a "name".  The decon is
+  // done once and the ROI finding and outputs once per object, with
+  // the outputs tagged with the usual tags plus "_" and the name.
+  cfg["roi_sweep"] = Json::arrayValue;
+  // number of threads over which to spread the parameter sets.
+  // These are per plane thread.
+  cfg["sweep_nthreads"] = m_sweep_nthreads;
       
   // fixme: unused?
   cfg["charge_ch_offset"] = m_charge_ch_offset;
@@ -274,125 +413,251 @@ WireCell::Configuration OmnibusSigProc::default_configuration() const
   
   cfg["sparse"] = false;
 
+  // The products to make, any of "wiener" (also giving the
+  // thresholds) and "gauss", and the plane indices to make them
+  // for.  Work only needed for the others is skipped.
+  cfg["products"] = Json::arrayValue;
+  if (m_save_wiener) {
+    cfg["products"].append("wiener");
+  }
+  if (m_save_gauss) {
+    cfg["products"].append("gauss");
+  }
+  cfg["planes"] = Json::arrayValue;
+  for (int iplane = 0; iplane < 3; ++iplane) {
+    if (m_do_plane[iplane]) {
+      cfg["planes"].append(iplane);
+    }
+  }
+
+  // number of threads over which to spread the three planes
+  cfg["nthreads"] = m_nthreads;
+  // number of threads over which to spread the rows of a plane in
+  // row-wise steps.  These are per plane thread.
+  cfg["row_nthreads"] = m_row_nthreads;
+
   return cfg;
   
 }
 
-void OmnibusSigProc::load_data(const input_pointer& in, int plane){
-
-  // std::cout << m_fft_nwires[plane] << " " << m_fft_nticks << std::endl;
-  m_r_data = Array::array_xxf::Zero(m_fft_nwires[plane],m_fft_nticks);
-  //  m_r_data = Array::array_xxf::Zero(m_nwires[plane],m_nticks);
-
-  auto traces = in->traces();
+void OmnibusSigProc::bucket_input(Context& ctx, const input_pointer& in)
+{
+  const Kernels& kern = *ctx.kern;
+
+  // Mask ranges in ticks from the start of the readout and clipped
+  // to it so the users of tick_cmm() may index with them directly.
+  ctx.shifted_cmm.clear();
+  for (const auto& cm : ctx.cmm) {
+    auto& masks = ctx.shifted_cmm[cm.first];
+    for (const auto& chm : cm.second) {
+      auto& ranges = masks[chm.first];
+      for (const auto& br : chm.second) {
+        const int beg = std::max(br.first - ctx.tbin0, 0);
+        const int end = std::min(br.second - ctx.tbin0, kern.nticks);
+        if (beg < end) {
+          ranges.push_back(Waveform::BinRange(beg, end));
+        }
+      }
+    }
+  }
 
-  auto& bad = m_cmm["bad"];
-  int nbad = 0;
+  for (int iplane = 0; iplane < 3; ++iplane) {
+    ctx.work[iplane].in_traces.clear();
+    ctx.work[iplane].bad_ranges.clear();
+  }
 
-  for (auto trace : *traces.get()) {
-    int wct_channel_ident = trace->channel();
-    OspChan och = m_channel_map[wct_channel_ident];
-    if (plane != och.plane) {
-      continue;         // we'll catch it in another call to load_data
+  for (auto trace : *in->traces()) {
+    const int ind = m_chindex->index(trace->channel());
+    if (ind < 0) {
+      continue;         // not from our anode
+    }
+    const OspChan& och = m_osp_chans[ind];
+    if (!m_do_plane[och.plane]) {
+      continue;
     }
-
-    // fixme: this code uses tbin() but other places in this file will barf if tbin!=0.
-    int tbin = trace->tbin();
     auto const& charges = trace->charge();
-    const int ntbins = std::min((int)charges.size(), m_nticks);
-    for (int qind = 0; qind < ntbins; ++qind) {
-      m_r_data(och.wire + m_pad_nwires[plane], tbin + qind) = charges[qind];
+    const int ntbins = std::min((int)charges.size(), kern.nticks);
+    if (ntbins <= 0) {
+      continue;
     }
+    ctx.work[och.plane].in_traces.push_back(InTrace{och.wire + kern.pad_nwires[och.plane],
+          trace->tbin() - ctx.tbin0, charges.data(), ntbins});
+  }
 
-    //ensure dead channels are indeed dead ...
-    auto const& badch = bad.find(och.channel);
-    if (badch == bad.end()) {
+  //ensure dead channels are indeed dead ...
+  for (auto const& badch : ctx.tick_cmm().at("bad")) {
+    const OspChan& och = m_osp_chans[badch.first];
+    if (!m_do_plane[och.plane]) {
       continue;
     }
+    auto& work = ctx.work[och.plane];
+    for (auto const& br : badch.second) {
+      work.bad_ranges.push_back(BadRange{och.wire + kern.pad_nwires[och.plane], br.first, br.second});
+    }
+  }
+}
 
-    auto const& binranges = badch->second;
-    for (auto const& br : binranges) {
-      ++nbad;
-      for (int i = br.first; i != br.second; ++i) {
-        m_r_data(och.wire+m_pad_nwires[plane], i) = 0;
-      }
-      //std::cerr << plane << " " << ch << ": [" << br.first << "," << br.second << "]\n";
+void OmnibusSigProc::load_data(Context& ctx, int plane, int tbin0){
+
+  const Kernels& kern = *ctx.kern;
+  // std::cout << kern.fft_nwires[plane] << " " << kern.fft_nticks << std::endl;
+  // reuse the workspace, this only allocates if the shape changed
+  PlaneWork& work = ctx.work[plane];
+  auto& r_data = work.r_data;
+  r_data.resize(kern.fft_nwires[plane],kern.fft_nticks);
+  r_data.setZero();
+  const int ncols = kern.fft_nticks;
+
+  for (const auto& it : work.in_traces) {
+    // only the part that lands in this time window
+    const int qbeg = std::max(0, tbin0 - it.tick);
+    const int qend = std::min(it.nticks, tbin0 + ncols - it.tick);
+    if (qbeg >= qend) {
+      continue;
     }
+    r_data.row(it.row).segment(it.tick + qbeg - tbin0, qend - qbeg)
+      = Eigen::Map<const Eigen::ArrayXf>(it.data + qbeg, qend - qbeg).transpose();
+  }
 
+  // after all the data in case of multiple traces for a channel
+  for (const auto& br : work.bad_ranges) {
+    const int ibeg = std::max(br.beg, tbin0);
+    const int iend = std::min(br.end, tbin0 + ncols);
+    if (ibeg < iend) {
+      r_data.row(br.row).segment(ibeg - tbin0, iend - ibeg).setZero();
+    }
   }
-  std::cerr << "OmnibusSigProc: plane index: " << plane << " configured with " << nbad << " bad regions\n";
-  
 }
 
 // used in sparsifying below.  Could use C++17 lambdas....
 static bool ispositive(float x) { return x > 0.0; }
 static bool iszero(float x) { return x == 0.0; }
 
-void OmnibusSigProc::save_data(ITrace::vector& itraces, IFrame::trace_list_t& indices, int plane,
+// Collect per wire the tick ranges covered by the extended ROIs as
+// sorted, merged, half open ranges clamped to [0,nticks).
+static void roi_tick_ranges(SignalROIChList& rois, int nticks,
+                            std::vector<std::vector<std::pair<int,int> > >& ranges)
+{
+  ranges.resize(rois.size());
+  for (size_t irow=0; irow != rois.size(); ++irow) {
+    auto& rr = ranges[irow];
+    rr.clear();
+    for (SignalROI* roi : rois[irow]) {
+      const int beg = std::max(roi->get_ext_start_bin(), 0);
+      const int end = std::min(roi->get_ext_end_bin() + 1, nticks);
+      if (beg < end) {
+        rr.push_back(std::make_pair(beg, end));
+      }
+    }
+    if (rr.size() < 2) {
+      continue;
+    }
+    std::sort(rr.begin(), rr.end());
+    size_t nkeep = 0;
+    for (size_t ind=1; ind < rr.size(); ++ind) {
+      if (rr[ind].first <= rr[nkeep].second) {
+        rr[nkeep].second = std::max(rr[nkeep].second, rr[ind].second);
+      }
+      else {
+        rr[++nkeep] = rr[ind];
+      }
+    }
+    rr.resize(nkeep+1);
+  }
+}
+
+void OmnibusSigProc::save_data(Context& ctx, PlaneWork::SetWork& sw,
+                               ITrace::vector& itraces, IFrame::trace_list_t& indices, int plane,
+                               const Array::array_xxf& r_data,
                                const std::vector<float>& perwire_rmses,
                                IFrame::trace_summary_t& threshold)
 {
+  const int nticks = ctx.kern->nticks;
+
   // reuse this temporary vector to hold charge for a channel.
-  ITrace::ChargeSequence charge(m_nticks, 0.0);
+  ITrace::ChargeSequence& charge = sw.charge;
+  charge.assign(nticks, 0.0);
+
+  const auto& bad = ctx.tick_cmm().at("bad");
+  const auto& roi_ranges = sw.roi_ranges;
 
   double qtot = 0.0;
   for (auto och : m_channel_range[plane]) { // ordered by osp channel
-    
+    const float thresh = perwire_rmses[och.wire];
+    auto badit = bad.find(och.channel);
+
+    if (m_sparse) {
+      // The ROIs were applied so only their ranges can hold signal.
+      // Channels without ROIs produce no traces and are skipped.
+      for (const auto& range : roi_ranges[och.wire]) {
+        const int rbeg = range.first, rend = range.second;
+
+        // Post process: zero out any negative signal and that from "bad" channels.
+        for (int itick=rbeg; itick<rend; ++itick) {
+          const float q = r_data(och.wire, itick);
+          charge[itick] = q > 0.0 ? q : 0.0;
+        }
+        if (badit != bad.end()) {
+          for (auto br : badit->second) {
+            const int ibeg = std::max(br.first, rbeg), iend = std::min(br.second, rend);
+            for (int itick=ibeg; itick < iend; ++itick) {
+              charge[itick] = 0.0;
+            }
+          }
+        }
+
+        // Save waveform sparsely by finding contiguous, positive samples.
+        std::vector<float>::const_iterator beg=charge.begin();
+        auto end = beg + rend;
+        auto i1 = std::find_if(beg + rbeg, end, ispositive); // first start
+        while (i1 != end) {
+          // stop at next zero or end of range
+          auto i2 = std::find_if(i1, end, iszero);
+          const std::vector<float> q(i1,i2);
+          for (auto x : q) {
+            qtot += x;          // debug
+          }
+
+          // save out
+          const int tbin = i1 - beg + ctx.tbin0;
+          SimpleTrace *trace = new SimpleTrace(och.ident, tbin, q);
+          const size_t trace_index = itraces.size();
+          indices.push_back(trace_index);
+          itraces.push_back(ITrace::pointer(trace));
+          threshold.push_back(thresh);
+
+          // find start for next loop
+          i1 = std::find_if(i2, end, ispositive);
+        }
+      }
+      continue;
+    }
+
     // Post process: zero out any negative signal and that from "bad" channels.
     // fixme: better if we move this outside of save_data().
-    for (int itick=0;itick!=m_nticks;itick++){
-      const float q = m_r_data(och.wire, itick);
+    for (int itick=0;itick!=nticks;itick++){
+      const float q = r_data(och.wire, itick);
       charge.at(itick) = q > 0.0 ? q : 0.0;
     }
-    {
-      auto& bad = m_cmm["bad"];
-      auto badit = bad.find(och.channel);
-      if (badit != bad.end()) {
-        for (auto bad : badit->second) {
-          for (int itick=bad.first; itick < bad.second; ++itick) {
-            charge.at(itick) = 0.0;
-          }
+    if (badit != bad.end()) {
+      for (auto br : badit->second) {
+        for (int itick=br.first; itick < br.second; ++itick) {
+          charge.at(itick) = 0.0;
         }
       }
     }
 
     // debug
-    for (int j=0;j!=m_nticks;j++){
+    for (int j=0;j!=nticks;j++){
       qtot += charge.at(j);
     }
 
-    const float thresh = perwire_rmses[och.wire];
-
-    // actually save out
-    if (m_sparse) {
-      // Save waveform sparsely by finding contiguous, positive samples.
-      std::vector<float>::const_iterator beg=charge.begin(), end=charge.end();
-      auto i1 = std::find_if(beg, end, ispositive); // first start
-      while (i1 != end) {
-        // stop at next zero or end and make little temp vector
-        auto i2 = std::find_if(i1, end, iszero);
-        const std::vector<float> q(i1,i2);
-
-        // save out
-        const int tbin = i1 - beg;
-        SimpleTrace *trace = new SimpleTrace(och.ident, tbin, q);
-        const size_t trace_index = itraces.size();
-        indices.push_back(trace_index);
-        itraces.push_back(ITrace::pointer(trace));
-        threshold.push_back(thresh);
-
-        // find start for next loop
-        i1 = std::find_if(i2, end, ispositive);
-      }
-    }
-    else {
-      // Save the waveform densely, including zeros.
-      SimpleTrace *trace = new SimpleTrace(och.ident, 0, charge);
-      const size_t trace_index = itraces.size();
-      indices.push_back(trace_index);
-      itraces.push_back(ITrace::pointer(trace));
-      threshold.push_back(thresh);
-    }
+    // Save the waveform densely, including zeros.
+    SimpleTrace *trace = new SimpleTrace(och.ident, ctx.tbin0, charge);
+    const size_t trace_index = itraces.size();
+    indices.push_back(trace_index);
+    itraces.push_back(ITrace::pointer(trace));
+    threshold.push_back(thresh);
   }
 
   // debug
@@ -408,57 +673,109 @@ void OmnibusSigProc::save_data(ITrace::vector& itraces, IFrame::trace_list_t& in
 }
 
 
-void OmnibusSigProc::init_overall_response(IFrame::pointer frame)
+int OmnibusSigProc::fft_ticks_length(int nticks)
 {
-  m_period = frame->tick();
-  {
-    std::vector<int> tbins;
-    for (auto trace : *frame->traces()) {
-      const int tbin = trace->tbin();
-      const int nbins = trace->charge().size();
-      tbins.push_back(tbin);
-      tbins.push_back(tbin+nbins);
-    }
-    auto mme = std::minmax_element(tbins.begin(), tbins.end());
-    int tbinmin = *mme.first;
-    int tbinmax = *mme.second;
-    m_nticks = tbinmax-tbinmin;
-    std::cerr <<"OmnibusSigProc: nticks=" << m_nticks << " tbinmin="<<tbinmin << " tbinmax="<<tbinmax<<std::endl;
+  if (m_fft_flag == 0) {
+    return nticks;
+  }
+  const int guess = fft_best_length(nticks);
+  if (m_fft_flag != 2) {
+    return guess;
+  }
+  // measure, allowing a bit more padding than the guess
+  const int nmax = std::max(guess, (int)(nticks * (1.0 + m_fft_tune_slack)));
+  return m_fft_tuner->best_length(nticks, nmax);
+}
 
-    if (m_fft_flag==0){
-      m_fft_nticks = m_nticks;
-    }else{
-      m_fft_nticks = fft_best_length(m_nticks);
-      std::cerr << "SigProc: enlarge window from " << m_nticks << " to " << m_fft_nticks << std::endl;
-    }
-    //
-    
-    m_pad_nticks = m_fft_nticks - m_nticks;
+OmnibusSigProc::kernels_pointer OmnibusSigProc::kernels(double period, int nticks)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  // Nothing the responses depend on has changed, reuse them.
+  if (m_kernels && m_kernels->period == period && m_kernels->nticks == nticks) {
+    return m_kernels;
   }
 
-  auto ifr = Factory::find_tn<IFieldResponse>(m_field_response);
-  // Get full, "fine-grained" field responses defined at impact
-  // positions.
-  Response::Schema::FieldResponse fr = ifr->field_response();
-  
-  // Make a new data set which is the average FR
-  Response::Schema::FieldResponse fravg = Response::wire_region_average(fr);
+  // Frames in flight keep the kernels they started with.
+  auto kern = std::make_shared<Kernels>();
+  kern->period = period;
+  kern->nticks = nticks;
+  init_overall_response(*kern);
+  m_kernels = kern;
+  return m_kernels;
+}
+
+void OmnibusSigProc::init_overall_response(Kernels& kern)
+{
+  const double period = kern.period;
+  const int nticks = kern.nticks;
+
+  // The field response only changes on reconfigure, load it once
+  // after that.
+  if (!m_have_fravg) {
+    auto ifr = Factory::find_tn<IFieldResponse>(m_field_response);
+    // Get full, "fine-grained" field responses defined at impact
+    // positions.
+    Response::Schema::FieldResponse fr = ifr->field_response();
+
+    // Make a new data set which is the average FR
+    m_fravg = Response::wire_region_average(fr);
+    m_intrinsic_time_offset = fr.origin/fr.speed;
+    m_have_fravg = true;
+  }
+  const Response::Schema::FieldResponse& fravg = m_fravg;
+
+  // Time window of each FFT.  Normally the whole readout, but in
+  // chunked mode the readout is deconvolved in chunks of
+  // chunk_len ticks, each extended on both sides by a margin
+  // covering the response length (overlap-save).
+  kern.chunk_len = 0;
+  kern.chunk_margin_nticks = 0;
+  if (m_chunk_nticks > 0 && nticks > m_chunk_nticks) {
+    kern.chunk_margin_nticks = m_chunk_margin;
+    if (kern.chunk_margin_nticks <= 0) {
+      const size_t resp_nticks = fft_best_length(fravg.planes[0].paths[0].current.size());
+      kern.chunk_margin_nticks = std::ceil(resp_nticks * fravg.period / period);
+    }
+    kern.fft_nticks = fft_ticks_length(m_chunk_nticks + 2*kern.chunk_margin_nticks);
+    kern.chunk_len = kern.fft_nticks - 2*kern.chunk_margin_nticks;
+    // the chunks rarely change after the first frame, say when they do
+    if (m_noted_chunks != std::make_pair(kern.chunk_len, kern.chunk_margin_nticks)) {
+      m_noted_chunks = std::make_pair(kern.chunk_len, kern.chunk_margin_nticks);
+      std::cerr << "SigProc: decon in chunks of " << kern.chunk_len << " ticks with margin "
+                << kern.chunk_margin_nticks << ", FFT length " << kern.fft_nticks << std::endl;
+    }
+  }
+  else {
+    kern.fft_nticks = fft_ticks_length(nticks);
+    if (kern.fft_nticks != nticks) {
+      std::cerr << "SigProc: enlarge window from " << nticks << " to " << kern.fft_nticks << std::endl;
+    }
+  }
+  kern.pad_nticks = std::max(0, kern.fft_nticks - nticks);
+  const int fft_nticks = kern.fft_nticks;
   
   for (int i=0;i!=3;i++){
     //
     if (m_fft_flag==0){
-      m_fft_nwires[i] = m_nwires[i];
+      kern.fft_nwires[i] = m_nwires[i];
     }else{
-      m_fft_nwires[i] = fft_best_length(m_nwires[i]+fravg.planes[0].paths.size()-1,1);
-      std::cerr << "SigProc: enlarge wire number in plane " << i << " from " << m_nwires[i] << " to " << m_fft_nwires[i] << std::endl;
+      kern.fft_nwires[i] = fft_best_length(m_nwires[i]+fravg.planes[0].paths.size()-1,1);
+      std::cerr << "SigProc: enlarge wire number in plane " << i << " from " << m_nwires[i] << " to " << kern.fft_nwires[i] << std::endl;
     }
-    m_pad_nwires[i] = (m_fft_nwires[i]-m_nwires[i])/2;
-    //std::cout << i << " " << m_fft_nwires[i] << " " << m_pad_nwires[i] << " " << m_fft_nticks << " " << m_pad_nticks << std::endl;
+    kern.pad_nwires[i] = (kern.fft_nwires[i]-m_nwires[i])/2;
+    //std::cout << i << " " << kern.fft_nwires[i] << " " << kern.pad_nwires[i] << " " << kern.fft_nticks << " " << kern.pad_nticks << std::endl;
+  }
+
+  kern.time_shift = (m_coarse_time_offset + m_intrinsic_time_offset)/period;
+  if (kern.time_shift < 0) {
+    kern.time_shift = 0;
   }
+
+  std::cerr << "OmnibusSigProc: (re)building overall response for nticks=" << fft_nticks << "\n";
   
   //std::cout << fravg.planes[0].paths.size() << " " << fravg.planes[0].paths[0].current.size() << std::endl;
   //std::cout << Response::as_array(fravg.planes[0]).cols() << " " << Response::as_array(fravg.planes[0]).rows() << std::endl;
-
   // since we only do FFT along time, no need to change dimension for wire ...
   const size_t fine_nticks = fft_best_length(fravg.planes[0].paths[0].current.size());
   int fine_nwires = fravg.planes[0].paths.size();
@@ -474,10 +791,10 @@ void OmnibusSigProc::init_overall_response(IFrame::pointer frame)
 
   std::complex<float> fine_period(fravg.period,0);
   
-  Waveform::realseq_t wfs(m_fft_nticks);
-  Waveform::realseq_t ctbins(m_fft_nticks);
-  for (int i=0;i!=m_fft_nticks;i++){
-    ctbins.at(i) = i * m_period;
+  Waveform::realseq_t wfs(fft_nticks);
+  Waveform::realseq_t ctbins(fft_nticks);
+  for (int i=0;i!=fft_nticks;i++){
+    ctbins.at(i) = i * period;
   }
 
   
@@ -487,14 +804,9 @@ void OmnibusSigProc::init_overall_response(IFrame::pointer frame)
     ftbins.at(i) = i * fravg.period;
   }
 
-  // clear the overall response
-  for (int i=0;i!=3;i++){
-    overall_resp[i].clear();
-  }
-
-  m_intrinsic_time_offset = fr.origin/fr.speed;
+  //average overall responses
+  std::vector<Waveform::realseq_t> overall_resp[3];
 
-  
   // Convert each average FR to a 2D array
   for (int iplane=0; iplane<3; ++iplane) {
     auto arr = Response::as_array(fravg.planes[iplane], fine_nwires, fine_nticks);
@@ -537,7 +849,7 @@ void OmnibusSigProc::init_overall_response(IFrame::pointer frame)
       // gtemp = new TGraph();
       
       size_t fcount = 1;
-      for (int i=0;i!=m_fft_nticks;i++){
+      for (int i=0;i!=fft_nticks;i++){
 	double ctime = ctbins.at(i);
 	
 	if (fcount < fine_nticks)
@@ -561,355 +873,343 @@ void OmnibusSigProc::init_overall_response(IFrame::pointer frame)
 
     
     // calculated the wire shift ...     
-    m_wire_shift[iplane] = (int(overall_resp[iplane].size())-1)/2;
+    kern.wire_shift[iplane] = (int(overall_resp[iplane].size())-1)/2;
 
-    //    std::cout << /m_period << std::endl;
+    //    std::cout << /period << std::endl;
   }//  loop over plane
 
-  
-  
+  init_decon_kernels(kern, overall_resp);
+  init_chan_corr(kern);
+  init_filter_spectra(kern);
 }
 
-void OmnibusSigProc::restore_baseline(Array::array_xxf& arr){
-  
-  for (int i=0;i!=arr.rows();i++){
-    Waveform::realseq_t signal(arr.cols());
-    int ncount = 0;
-    for (int j=0;j!=arr.cols();j++){
-      if (arr(i,j)!=0){
-	signal.at(ncount) = arr(i,j);
-	ncount ++;
-      }
+void OmnibusSigProc::init_filter_spectra(Kernels& kern)
+{
+  const int nbins = kern.fft_nticks;
+  for (int iplane=0; iplane<3; ++iplane) {
+    if (!m_do_plane[iplane]) {
+      continue;               // not needed
+    }
+    const PlaneFilters& pf = m_plane_filters[iplane];
+    Kernels::Spectra& spec = kern.spectra[iplane];
+    spec.tight = m_filter_bank.spectrum(pf.tight, nbins);
+    spec.tighter = m_filter_bank.spectrum(pf.tighter, nbins);
+    spec.loose = m_filter_bank.spectrum(pf.loose, nbins);
+    spec.refine = m_filter_bank.spectrum(pf.refine, nbins);
+    spec.hits = m_filter_bank.spectrum(pf.hits, nbins);
+    spec.charge = m_filter_bank.spectrum(pf.charge, nbins);
+  }
+}
+
+void OmnibusSigProc::init_decon_kernels(Kernels& kern, const std::vector<Waveform::realseq_t> overall_resp[3])
+{
+  const int fft_nticks = kern.fft_nticks;
+  for (int iplane=0; iplane<3; ++iplane) {
+    if (!m_do_plane[iplane]) {
+      continue;               // not needed
     }
-    signal.resize(ncount);
-    float baseline = WireCell::Waveform::median_binned(signal);
-    // std::cout << i << " " << baseline << " " << signal.size() << " ";
-    Waveform::realseq_t temp_signal(arr.cols());
-    ncount = 0;
-    for (size_t j =0; j!=signal.size();j++){
-      if (fabs(signal.at(j)-baseline) < 500){
-	temp_signal.at(ncount) = signal.at(j);
-	ncount ++;
+    //response part ...
+    Array::array_xxf r_resp = Array::array_xxf::Zero(kern.fft_nwires[iplane],fft_nticks);
+    for (size_t i=0;i!=overall_resp[iplane].size();i++){
+      for (int j=0;j!=fft_nticks;j++){
+        r_resp(i,j) = overall_resp[iplane].at(i).at(j);
       }
     }
-    temp_signal.resize(ncount);
-    
-    baseline = WireCell::Waveform::median_binned(temp_signal);
-    //std::cout << baseline << " " << temp_signal.size() << std::endl;
-    
-    for (int j=0;j!=arr.cols();j++){
-      if (arr(i,j)!=0)
-	arr(i,j) -= baseline;
+  
+    // do first round FFT on the resposne on time, keeping only the
+    // non-redundant half of the spectrum
+    auto fft = FFTEngine::make(m_fft_backend, kern.fft_nwires[iplane], fft_nticks);
+    Array::array_xxc c_resp;
+    fft->fwd_rows_half(r_resp, c_resp);
+    // do second round FFT on the response on wire
+    fft->fwd_cols(c_resp);
+
+    // software filter on wire
+    const Waveform::realseq_t& wire_filter_wf = m_filter_bank.spectrum(m_plane_filters[iplane].wire, c_resp.rows());
+
+    // Invert the response and fold in the wire filter.  Where the
+    // response vanishes the deconvolved data would be NaN or Inf
+    // which was zeroed anyways so zero the kernel there.
+    auto& kernel = kern.decon_kernel[iplane];
+    kernel.resize(c_resp.rows(), c_resp.cols());
+    for (int icol=0; icol<c_resp.cols(); ++icol) {
+      for (int irow=0; irow<c_resp.rows(); ++irow) {
+        const std::complex<float> val = wire_filter_wf.at(irow) / c_resp(irow,icol);
+        if (std::isfinite(val.real()) && std::isfinite(val.imag())) {
+          kernel(irow,icol) = val;
+        }
+        else {
+          kernel(irow,icol) = 0.0;
+        }
+      }
     }
   }
 }
 
+void OmnibusSigProc::init_chan_corr(Kernels& kern)
+{
+  const double period = kern.period;
+  const int fft_nticks = kern.fft_nticks;
+  for (int iplane=0; iplane<3; ++iplane) {
+    kern.chan_corr[iplane].resize(0,0);
+  }
+  if (m_per_chan_resp.empty()) {
+    return;
+  }
 
-void OmnibusSigProc::decon_2D_init(int plane){
-
-  // data part ... 
-  // first round of FFT on time
-  m_c_data = Array::dft_rc(m_r_data,0);
+  std::cerr<<"OmnibusSigProc: CH-BY-CH ELECTRONICS RESPONSE CORRECTION\n";
+  auto cr = Factory::find_tn<IChannelResponse>(m_per_chan_resp);
+  auto cr_bins = cr->channel_response_binning();
+  if (cr_bins.binsize() != period) {
+    THROW(ValueError() << errmsg{"OmnibusSigProc::init_chan_corr: channel response size mismatch"});
+  }
+  //starndard electronics response ... 
+  // WireCell::Binning tbins(m_nticks, 0-m_period/2., m_nticks*m_period-m_period/2.);
+  // Response::ColdElec ce(m_gain, m_shaping_time);
+
+  // temporary hack ...
+  //float scaling = 1./(1e-9*0.5/1.13312);
+  //WireCell::Binning tbins(m_nticks, (-5-0.5)*m_period, (m_nticks-5-0.5)*m_period-m_period);
+  //Response::ColdElec ce(m_gain*scaling, m_shaping_time);
+  //// this is moved into wirecell.sigproc.main production of
+  //// microboone-channel-responses-v1.json.bz2
+  WireCell::Binning tbins(fft_nticks, cr_bins.min(), cr_bins.min() + fft_nticks*period);
+  Response::ColdElec ce(m_gain, m_shaping_time);
+    
+  const auto ewave = ce.generate(tbins);
+  const WireCell::Waveform::compseq_t elec = Waveform::dft(ewave);
 
-  
-  // now apply the ch-by-ch response ...
-  if (! m_per_chan_resp.empty()) {
-    std::cerr<<"OmnibusSigProc: CH-BY-CH ELECTRONICS RESPONSE CORRECTION\n";
-    auto cr = Factory::find_tn<IChannelResponse>(m_per_chan_resp);
-    auto cr_bins = cr->channel_response_binning();
-    if (cr_bins.binsize() != m_period) {
-      THROW(ValueError() << errmsg{"OmnibusSigProc::decon_2D_init: channel response size mismatch"});
+  for (int iplane=0; iplane<3; ++iplane) {
+    if (!m_do_plane[iplane]) {
+      continue;               // not needed
     }
-    //starndard electronics response ... 
-    // WireCell::Binning tbins(m_nticks, 0-m_period/2., m_nticks*m_period-m_period/2.);
-    // Response::ColdElec ce(m_gain, m_shaping_time);
-
-    // temporary hack ...
-    //float scaling = 1./(1e-9*0.5/1.13312);
-    //WireCell::Binning tbins(m_nticks, (-5-0.5)*m_period, (m_nticks-5-0.5)*m_period-m_period);
-    //Response::ColdElec ce(m_gain*scaling, m_shaping_time);
-    //// this is moved into wirecell.sigproc.main production of
-    //// microboone-channel-responses-v1.json.bz2
-    WireCell::Binning tbins(m_fft_nticks, cr_bins.min(), cr_bins.min() + m_fft_nticks*m_period);
-    Response::ColdElec ce(m_gain, m_shaping_time);
-    
-    const auto ewave = ce.generate(tbins);
-    const WireCell::Waveform::compseq_t elec = Waveform::dft(ewave);
+    // Padding rows have no channel and are left as is.
+    auto& corr = kern.chan_corr[iplane];
+    corr = Array::array_xxc::Ones(kern.fft_nwires[iplane], fft_nticks/2+1);
 
-    for (auto och : m_channel_range[plane]) {
-      //const auto& ch_resp = cr->channel_response(och.ident);
+    for (auto och : m_channel_range[iplane]) {
       Waveform::realseq_t tch_resp = cr->channel_response(och.ident);
-      tch_resp.resize(m_fft_nticks,0);
+      tch_resp.resize(fft_nticks,0);
       const WireCell::Waveform::compseq_t ch_elec = Waveform::dft(tch_resp);
 
-      const int irow = och.wire+m_pad_nwires[plane];
-      for (int icol = 0; icol != m_c_data.cols(); icol++){
+      const int irow = och.wire+kern.pad_nwires[iplane];
+      for (int icol = 0; icol != corr.cols(); icol++){
         const auto four = ch_elec.at(icol);
-	if (std::abs(four) != 0){
-	  m_c_data(irow,icol) *= elec.at(icol) / four;
-	}else{
-	  m_c_data(irow,icol) = 0;
-	}
+        if (std::abs(four) != 0){
+          corr(irow,icol) = elec.at(icol) / four;
+        }else{
+          corr(irow,icol) = 0;
+        }
       }
     }
   }
+}
 
+void OmnibusSigProc::restore_baseline(Array::array_xxf& arr, PlaneWork& work,
+                                      const std::vector<int>* rows){
 
-  
-  
-  //second round of FFT on wire
-  m_c_data = Array::dft_cc(m_c_data,1);
-  
-  //response part ...
-  Array::array_xxf r_resp = Array::array_xxf::Zero(m_r_data.rows(),m_fft_nticks);
-  for (size_t i=0;i!=overall_resp[plane].size();i++){
-    for (int j=0;j!=m_fft_nticks;j++){
-      r_resp(i,j) = overall_resp[plane].at(i).at(j);
-    }
+  // Rows are independent.  Each thread reuses its own scratch,
+  // kept across rows and frames.  Results do not depend on threading.
+  const int nrows = arr.rows(), ncols = arr.cols();
+  const int nthreads = std::max(1, std::min(m_row_nthreads, nrows));
+  if ((int)work.rows.size() < nthreads) {
+    work.rows.resize(nthreads);
   }
-  
-  // do first round FFT on the resposne on time
-  Array::array_xxc c_resp = Array::dft_rc(r_resp,0);
-  // do second round FFT on the response on wire
-  c_resp = Array::dft_cc(c_resp,1);
+  parallel_chunks(nrows, nthreads, [&](int ithread, int beg, int end) {
+      Waveform::realseq_t& signal = work.rows[ithread].signal;
+      Waveform::realseq_t& temp_signal = work.rows[ithread].temp_signal;
+      RobustStats& stats = work.rows[ithread].stats;
+      signal.resize(ncols);
+      temp_signal.resize(ncols);
+      for (int i=beg; i<end; ++i) {
+        if (rows && !(*rows)[i]) {
+          continue;           // known to be all zero
+        }
+        // non-zero samples
+        int ncount = 0;
+        for (int j=0; j<ncols; ++j) {
+          const float val = arr(i,j);
+          signal[ncount] = val;
+          ncount += (val != 0);
+        }
+        float baseline = stats.median(signal.data(), ncount);
+
+        // those not too far from the first estimate
+        int ntemp = 0;
+        for (int j=0; j<ncount; ++j) {
+          const float val = signal[j];
+          temp_signal[ntemp] = val;
+          ntemp += (fabs(val-baseline) < 500);
+        }
+        baseline = stats.median(temp_signal.data(), ntemp);
 
-  
-  //make ratio to the response and apply wire filter
-  m_c_data = m_c_data/c_resp;
-  //std::cout << "Apply Wire Filter! " << std::endl;
-  // apply software filter on wire
-  const std::vector<std::string> filter_names{"Wire_ind", "Wire_ind", "Wire_col"};
-  Waveform::realseq_t wire_filter_wf;
-  auto ncr1 = Factory::find<IFilterWaveform>("HfFilter", filter_names[plane]);
-  wire_filter_wf = ncr1->filter_waveform(m_c_data.rows());
-  for (int irow=0; irow<m_c_data.rows(); ++irow) {
-    for (int icol=0; icol<m_c_data.cols(); ++icol) {
-      float val = abs(m_c_data(irow,icol));
-      if (std::isnan(val)) {
-	m_c_data(irow,icol) = -0.0;
-      }
-      if (std::isinf(val)) {
-	m_c_data(irow,icol) = 0.0;
+        for (int j=0; j<ncols; ++j) {
+          float& val = arr(i,j);
+          if (val != 0) {
+            val -= baseline;
+          }
+        }
       }
-      m_c_data(irow,icol) *= wire_filter_wf.at(irow);
-    }
-  }
-  
-  //do the first round of inverse FFT on wire
-  m_c_data = Array::idft_cc(m_c_data,1);
-
-  // do the second round of inverse FFT on time
-  m_r_data = Array::idft_cr(m_c_data,0);
-
-  // do the shift in wire 
-  const int nrows = m_r_data.rows();
-  const int ncols = m_r_data.cols();
-  {    // std::cout << nrows << " " << ncols << " " << m_wire_shift[plane] << std::endl;
-    Array::array_xxf arr1(m_wire_shift[plane], ncols) ;
-    arr1 = m_r_data.block(nrows-m_wire_shift[plane] , 0 , m_wire_shift[plane], ncols);
-    Array::array_xxf arr2(nrows-m_wire_shift[plane],ncols);
-    arr2 = m_r_data.block(0,0,nrows-m_wire_shift[plane],ncols);
-    m_r_data.block(0,0,m_wire_shift[plane],ncols) = arr1;
-    m_r_data.block(m_wire_shift[plane],0,nrows-m_wire_shift[plane],ncols) = arr2;
-  }
-  
-  //do the shift in time
-  int time_shift = (m_coarse_time_offset + m_intrinsic_time_offset)/m_period;
-  if (time_shift > 0){
-    Array::array_xxf arr1(nrows,ncols - time_shift);
-    arr1 = m_r_data.block(0,0,nrows,ncols - time_shift);
-    Array::array_xxf arr2(nrows,time_shift);
-    arr2 = m_r_data.block(0,ncols-time_shift,nrows,time_shift);
-    m_r_data.block(0,0,nrows,time_shift) = arr2;
-    m_r_data.block(0,time_shift,nrows,ncols-time_shift) = arr1;
-  }
-  m_c_data = Array::dft_rc(m_r_data,0);
+    });
 }
 
 
-void OmnibusSigProc::decon_2D_ROI_refine(int plane){
-   // apply software filter on time
-  //std::cout << "Apply Time Filter! " << std::endl;
-  const std::vector<std::string> filter_names{"Wiener_tight_U", "Wiener_tight_V", "Wiener_tight_W"};
-  Waveform::realseq_t roi_hf_filter_wf;
+void OmnibusSigProc::decon_2D_init(Context& ctx, int plane){
 
-  auto ncr1 = Factory::find<IFilterWaveform>("HfFilter", filter_names[plane]);
-  roi_hf_filter_wf = ncr1->filter_waveform(m_c_data.cols());
+  const Kernels& kern = *ctx.kern;
+  FFTEngine& fft = *ctx.fft[plane];
 
-  Array::array_xxc c_data_afterfilter(m_c_data.rows(),m_c_data.cols());
-  for (int irow=0; irow<m_c_data.rows(); ++irow) {
-    for (int icol=0; icol<m_c_data.cols(); ++icol) {
-      c_data_afterfilter(irow,icol) = m_c_data(irow,icol) * roi_hf_filter_wf.at(icol);
-    }
+  // data part ... 
+  // first round of FFT on time.  The data are real so only the
+  // non-redundant half of the time frequencies are kept from here on.
+  PlaneWork& work = ctx.work[plane];
+  fft.fwd_rows_half(work.r_data, work.c_data);
+
+  
+  // now apply the ch-by-ch response ...
+  if (kern.chan_corr[plane].size()) {
+    work.c_data *= kern.chan_corr[plane];
   }
+
+  //second round of FFT on wire
+  fft.fwd_cols(work.c_data);
+  
+  // divide out the response and apply the wire filter in one go
+  work.c_data *= kern.decon_kernel[plane];
   
-  //do the second round of inverse FFT on wire
-  Array::array_xxf tm_r_data = Array::idft_cr(c_data_afterfilter,0);
-  m_r_data = tm_r_data.block(m_pad_nwires[plane],0,m_nwires[plane],m_nticks);
-  restore_baseline(m_r_data);
+  //do the first round of inverse FFT on wire
+  fft.inv_cols(work.c_data);
+
+  // The time transform is left as is.  The wire and time shifts and
+  // the time filters are applied by decon_2D_products().
 }
 
 
-void OmnibusSigProc::decon_2D_tightROI(int plane){
-  // apply software filter on time
-  //std::cout << "Apply Time Filter! " << std::endl;
-  Waveform::realseq_t roi_hf_filter_wf;
-  if (plane ==0){
-    auto ncr1 = Factory::find<IFilterWaveform>("HfFilter","Wiener_tight_U");
-    roi_hf_filter_wf = ncr1->filter_waveform(m_c_data.cols());
-    auto ncr2 = Factory::find<IFilterWaveform>("LfFilter","ROI_tight_lf");
-    auto temp_filter = ncr2->filter_waveform(m_c_data.cols());
-    for(size_t i=0;i!=roi_hf_filter_wf.size();i++){
-      roi_hf_filter_wf.at(i) *= temp_filter.at(i);
+void OmnibusSigProc::decon_2D_products(Context& ctx, int plane, const std::vector<DeconProduct>& products,
+                                       int out_tick, int out_nticks, int src_offset,
+                                       const std::vector<int>* rows)
+{
+  const Kernels& kern = *ctx.kern;
+  PlaneWork& work = ctx.work[plane];
+  const Array::array_xxc& c_data = work.c_data;
+  const int nrows = c_data.rows();
+  const int nhalf = c_data.cols();
+  const int ncols = kern.fft_nticks;
+
+  // The shifts are done by indexing instead of moving data.  Output
+  // wire "iwire" comes from row "iwire + pad - wire_shift" and tick
+  // "out_tick + j" from tick "src_offset + j", both circularly.
+  Eigen::VectorXcf& spec = work.spec;
+  Eigen::VectorXf& wave = work.wave;
+  spec.resize(nhalf);
+  wave.resize(ncols);
+  for (int iwire = 0; iwire < m_nwires[plane]; ++iwire) {
+    if (rows && !(*rows)[iwire]) {
+      for (auto& prod : products) {
+        prod.out->row(iwire).segment(out_tick, out_nticks).setZero();
+      }
+      continue;
     }
-  }else if (plane==1){
-    auto ncr1 = Factory::find<IFilterWaveform>("HfFilter","Wiener_tight_V");
-    roi_hf_filter_wf = ncr1->filter_waveform(m_c_data.cols());
-    auto ncr2 = Factory::find<IFilterWaveform>("LfFilter","ROI_tight_lf");
-    auto temp_filter = ncr2->filter_waveform(m_c_data.cols());
-    for(size_t i=0;i!=roi_hf_filter_wf.size();i++){
-      roi_hf_filter_wf.at(i) *= temp_filter.at(i);
+    const int irow = ((iwire + kern.pad_nwires[plane] - kern.wire_shift[plane]) % nrows + nrows) % nrows;
+    for (auto& prod : products) {
+      const bool use_alt = prod.choice && (*prod.choice)[iwire];
+      const Waveform::realseq_t& filt = use_alt ? *prod.alt_filter : *prod.filter;
+      for (int icol=0; icol<nhalf; ++icol) {
+        spec(icol) = c_data(irow,icol) * filt[icol];
+      }
+      ctx.fft[plane]->inv_row_half(spec, wave);
+      Array::array_xxf& out = *prod.out;
+      for (int j=0; j<out_nticks; ++j) {
+        out(iwire,out_tick + j) = wave(((src_offset + j) % ncols + ncols) % ncols);
+      }
     }
-  }else{
-    auto ncr1 = Factory::find<IFilterWaveform>("HfFilter","Wiener_tight_W");
-    roi_hf_filter_wf = ncr1->filter_waveform(m_c_data.cols());
   }
+}
 
-  Array::array_xxc c_data_afterfilter(m_c_data.rows(),m_c_data.cols());
-  for (int irow=0; irow<m_c_data.rows(); ++irow) {
-    for (int icol=0; icol<m_c_data.cols(); ++icol) {
-      c_data_afterfilter(irow,icol) = m_c_data(irow,icol) * roi_hf_filter_wf.at(icol);
-    }
+void OmnibusSigProc::decon_2D(Context& ctx, int plane, const std::vector<DeconProduct>& products,
+                              const std::vector<int>* rows)
+{
+  const Kernels& kern = *ctx.kern;
+  for (auto& prod : products) {
+    prod.out->resize(m_nwires[plane], kern.nticks);
   }
-  
-  //do the second round of inverse FFT on wire
-  Array::array_xxf tm_r_data = Array::idft_cr(c_data_afterfilter,0);
-  m_r_data = tm_r_data.block(m_pad_nwires[plane],0,m_nwires[plane],m_nticks);
-  restore_baseline(m_r_data);
-  // std::cout << "Work on the tight ..." << std::endl;
-}
- 
-// same as above but with "tight" -> "tighter" for ROI filterss.
-void OmnibusSigProc::decon_2D_tighterROI(int plane){
-  // apply software filter on time
-  //std::cout << "Apply Time Filter! " << std::endl;
-  Waveform::realseq_t roi_hf_filter_wf;
-  if (plane ==0){
-    auto ncr1 = Factory::find<IFilterWaveform>("HfFilter","Wiener_tight_U");
-    roi_hf_filter_wf = ncr1->filter_waveform(m_c_data.cols());
-    auto ncr2 = Factory::find<IFilterWaveform>("LfFilter","ROI_tighter_lf");
-    auto temp_filter = ncr2->filter_waveform(m_c_data.cols());
-    for(size_t i=0;i!=roi_hf_filter_wf.size();i++){
-      roi_hf_filter_wf.at(i) *= temp_filter.at(i);
-    }
-  }else if (plane==1){
-    auto ncr1 = Factory::find<IFilterWaveform>("HfFilter","Wiener_tight_V");
-    roi_hf_filter_wf = ncr1->filter_waveform(m_c_data.cols());
-    auto ncr2 = Factory::find<IFilterWaveform>("LfFilter","ROI_tighter_lf");
-    auto temp_filter = ncr2->filter_waveform(m_c_data.cols());
-    for(size_t i=0;i!=roi_hf_filter_wf.size();i++){
-      roi_hf_filter_wf.at(i) *= temp_filter.at(i);
+
+  if (kern.chunk_len <= 0) {
+    // decon_2D_init() was run once on the whole readout
+    decon_2D_products(ctx, plane, products, 0, kern.nticks, -kern.time_shift, rows);
+  }
+  else {
+    // Overlap-save: each chunk's FFT window starts a margin before
+    // the first tick it contributes, also allowing for the time
+    // shift.  Only the middle chunk_len ticks are kept.
+    for (int tick = 0; tick < kern.nticks; tick += kern.chunk_len) {
+      const int nkeep = std::min(kern.chunk_len, kern.nticks - tick);
+      load_data(ctx, plane, tick - kern.time_shift - kern.chunk_margin_nticks);
+      decon_2D_init(ctx, plane);
+      decon_2D_products(ctx, plane, products, tick, nkeep, kern.chunk_margin_nticks, rows);
     }
-  }else{
-    auto ncr1 = Factory::find<IFilterWaveform>("HfFilter","Wiener_tight_W");
-    roi_hf_filter_wf = ncr1->filter_waveform(m_c_data.cols());
   }
 
-  Array::array_xxc c_data_afterfilter(m_c_data.rows(),m_c_data.cols());
-  for (int irow=0; irow<m_c_data.rows(); ++irow) {
-    for (int icol=0; icol<m_c_data.cols(); ++icol) {
-      c_data_afterfilter(irow,icol) = m_c_data(irow,icol) * roi_hf_filter_wf.at(icol);
+  // the baseline is restored on the full, stitched rows
+  for (auto& prod : products) {
+    if (prod.restore) {
+      restore_baseline(*prod.out, ctx.work[plane], rows);
     }
   }
-  
-  //do the second round of inverse FFT on wire
-  Array::array_xxf tm_r_data = Array::idft_cr(c_data_afterfilter,0);
-  m_r_data = tm_r_data.block(m_pad_nwires[plane],0,m_nwires[plane],m_nticks);
-  restore_baseline(m_r_data);
-
-  //  std::cout << "Work on the tighter ..." << std::endl;
 }
- 
 
-void OmnibusSigProc::decon_2D_looseROI(int plane){
-  if (plane == 2) {
-    return;                     // don't filter colleciton
-  }
-
-   // apply software filter on time
-  //std::cout << "Apply Time Filter! " << std::endl;
-  Waveform::realseq_t roi_hf_filter_wf;
-  Waveform::realseq_t roi_hf_filter_wf1;
-  Waveform::realseq_t roi_hf_filter_wf2;
-  if (plane ==0){
-    auto ncr1 = Factory::find<IFilterWaveform>("HfFilter","Wiener_tight_U");
-    roi_hf_filter_wf = ncr1->filter_waveform(m_c_data.cols());
-    roi_hf_filter_wf1 = roi_hf_filter_wf;
-    {
-      auto ncr2 = Factory::find<IFilterWaveform>("LfFilter","ROI_loose_lf");
-      auto temp_filter = ncr2->filter_waveform(m_c_data.cols());
-      for(size_t i=0;i!=roi_hf_filter_wf.size();i++){
-	roi_hf_filter_wf.at(i) *= temp_filter.at(i);
-      }
-    }
-    {
-      auto ncr2 = Factory::find<IFilterWaveform>("LfFilter","ROI_tight_lf");
-      auto temp_filter = ncr2->filter_waveform(m_c_data.cols());
-      for(size_t i=0;i!=roi_hf_filter_wf.size();i++){
-	roi_hf_filter_wf1.at(i) *= temp_filter.at(i);
-      }
-    }
-  }else if (plane==1){
-    auto ncr1 = Factory::find<IFilterWaveform>("HfFilter","Wiener_tight_V");
-    roi_hf_filter_wf = ncr1->filter_waveform(m_c_data.cols());
-    roi_hf_filter_wf1 = roi_hf_filter_wf;
-    {
-      auto ncr2 = Factory::find<IFilterWaveform>("LfFilter","ROI_loose_lf");
-      auto temp_filter = ncr2->filter_waveform(m_c_data.cols());
-      for(size_t i=0;i!=roi_hf_filter_wf.size();i++){
-	roi_hf_filter_wf.at(i) *= temp_filter.at(i);
-      }
-    }
-     {
-      auto ncr2 = Factory::find<IFilterWaveform>("LfFilter","ROI_tight_lf");
-      auto temp_filter = ncr2->filter_waveform(m_c_data.cols());
-      for(size_t i=0;i!=roi_hf_filter_wf.size();i++){
-	roi_hf_filter_wf1.at(i) *= temp_filter.at(i);
-      }
-    }
-  }else{
-    auto ncr1 = Factory::find<IFilterWaveform>("HfFilter","Wiener_tight_W");
-    roi_hf_filter_wf = ncr1->filter_waveform(m_c_data.cols());
-  }
+void OmnibusSigProc::add_ROI_products(Context& ctx, int plane, std::vector<DeconProduct>& products)
+{
+  const Kernels::Spectra& spec = ctx.kern->spectra[plane];
+  PlaneWork& work = ctx.work[plane];
 
-  const int n_lfn_nn = 2;
-  const int n_bad_nn = plane ? 1 : 2;
+  products.push_back(DeconProduct{&spec.tight, nullptr, nullptr,
+        &work.r_tight, true});
 
-  Array::array_xxc c_data_afterfilter(m_c_data.rows(),m_c_data.cols());
-  for (auto och : m_channel_range[plane]) {
-    const int irow = och.wire;
+  if (plane != 2) {             // collection only needs the tight ROIs
+    products.push_back(DeconProduct{&spec.tighter, nullptr, nullptr,
+          &work.r_tighter, true});
 
-    roi_hf_filter_wf2 = roi_hf_filter_wf;
-    if (masked_neighbors("bad", och, n_bad_nn) or
-        masked_neighbors("lf_noisy", och, n_lfn_nn))
-    {
-      roi_hf_filter_wf2 = roi_hf_filter_wf1;
-    }
-    
-    for (int icol=0; icol<m_c_data.cols(); ++icol) {
-      c_data_afterfilter(irow,icol) = m_c_data(irow,icol) * roi_hf_filter_wf2.at(icol);
+    // Loose ROIs use the tight low frequency cut near bad or low
+    // frequency noisy channels.
+    const int n_lfn_nn = 2;
+    const int n_bad_nn = plane ? 1 : 2;
+    work.loose_choice.assign(m_nwires[plane], 0);
+    for (auto och : m_channel_range[plane]) {
+      if (masked_neighbors(ctx, "bad", och, n_bad_nn) or
+          masked_neighbors(ctx, "lf_noisy", och, n_lfn_nn))
+      {
+        work.loose_choice[och.wire] = 1;
+      }
     }
+    products.push_back(DeconProduct{&spec.loose,
+          &spec.tight, &work.loose_choice,
+          &work.r_loose, true});
+
+    products.push_back(DeconProduct{&spec.refine, nullptr, nullptr,
+          &work.r_refine, true});
   }
-  
-  //do the second round of inverse FFT on wire
-  Array::array_xxf tm_r_data = Array::idft_cr(c_data_afterfilter,0);
-  m_r_data = tm_r_data.block(m_pad_nwires[plane],0,m_nwires[plane],m_nticks);
-  restore_baseline(m_r_data);
 }
 
+void OmnibusSigProc::add_output_products(Context& ctx, int plane, std::vector<DeconProduct>& products)
+{
+  const Kernels::Spectra& spec = ctx.kern->spectra[plane];
+  // the other sets get copies
+  PlaneWork::SetWork& sw = ctx.work[plane].sets.at(0);
+
+  // baseline is only restored for collection
+  if (m_save_wiener) {
+    products.push_back(DeconProduct{&spec.hits, nullptr, nullptr,
+          &sw.r_hits, plane==2});
+  }
+  if (m_save_gauss) {
+    products.push_back(DeconProduct{&spec.charge, nullptr, nullptr,
+          &sw.r_charge, plane==2});
+  }
+}
 
 // return true if any channels w/in +/- nnn, inclusive, of the channel has the mask.
-bool OmnibusSigProc::masked_neighbors(const std::string& cmname, OspChan& ochan, int nnn)
+bool OmnibusSigProc::masked_neighbors(const Context& ctx, const std::string& cmname, OspChan& ochan, int nnn) const
 {
   // take care of boundary cases
   int lo_wire = ochan.wire - nnn;
@@ -929,7 +1229,11 @@ bool OmnibusSigProc::masked_neighbors(const std::string& cmname, OspChan& ochan,
     return false;              
   }
 
-  auto& cm = m_cmm[cmname];
+  auto cmit = ctx.cmm.find(cmname);
+  if (cmit == ctx.cmm.end()) {
+    return false;
+  }
+  const auto& cm = cmit->second;
   for (int och = lo_chan; och <= hi_chan; ++och) {
     if (cm.find(och) != cm.end()) {
       return true;
@@ -938,66 +1242,292 @@ bool OmnibusSigProc::masked_neighbors(const std::string& cmname, OspChan& ochan,
   return false;
 }
 
-void OmnibusSigProc::decon_2D_hits(int plane){
-   // apply software filter on time
-  //std::cout << "Apply Time Filter! " << std::endl;
-  Waveform::realseq_t roi_hf_filter_wf;
-  if (plane ==0){
-    auto ncr1 = Factory::find<IFilterWaveform>("HfFilter","Wiener_wide_U");
-    roi_hf_filter_wf = ncr1->filter_waveform(m_c_data.cols());
-  }else if (plane==1){
-    auto ncr1 = Factory::find<IFilterWaveform>("HfFilter","Wiener_wide_V");
-    roi_hf_filter_wf = ncr1->filter_waveform(m_c_data.cols());
-  }else{
-    auto ncr1 = Factory::find<IFilterWaveform>("HfFilter","Wiener_wide_W");
-    roi_hf_filter_wf = ncr1->filter_waveform(m_c_data.cols());
-  }
-
-  Array::array_xxc c_data_afterfilter(m_c_data.rows(),m_c_data.cols());
-  for (int irow=0; irow<m_c_data.rows(); ++irow) {
-    for (int icol=0; icol<m_c_data.cols(); ++icol) {
-      c_data_afterfilter(irow,icol) = m_c_data(irow,icol) * roi_hf_filter_wf.at(icol);
+void OmnibusSigProc::process_plane(Context& ctx, int plane, std::vector<PlaneTraces>& out)
+{
+  const Kernels& kern = *ctx.kern;
+  const int nsets = m_roi_sets.size();
+
+  PlaneWork& work = ctx.work[plane];
+  work.sets.resize(nsets);
+  out.resize(nsets);
+  auto& products = work.products;
+  products.clear();
+  add_ROI_products(ctx, plane, products);
+
+  if (kern.chunk_len <= 0) {
+    // load data into EIGEN matrices ...
+    load_data(ctx, plane, 0); // load into a large matrix
+    // initial decon ... 
+    decon_2D_init(ctx, plane); // decon in large matrix
+  }
+  else {
+    // Chunks are deconvolved on the fly so make all products in
+    // one sweep rather than redo the decon for the outputs.
+    add_output_products(ctx, plane, products);
+  }
+
+  // All ROI finding products in one pass
+  decon_2D(ctx, plane, products);
+
+  // Each set of ROI parameters, usually just one, gets its own ROI
+  // state so sets and planes may run concurrently.  The decon
+  // products are only read.
+  std::vector<std::unique_ptr<ROI_formation> > roi_forms(nsets);
+  std::vector<std::unique_ptr<ROI_refinement> > roi_refines(nsets);
+  parallel_for(nsets, m_sweep_nthreads, [&](int iset) {
+      const RoiParams& rp = m_roi_sets[iset].params;
+      roi_forms[iset].reset(new ROI_formation(ctx.tick_cmm(), m_nwires[0], m_nwires[1], m_nwires[2], kern.nticks, rp.th_factor_ind, rp.th_factor_col, rp.pad, rp.asy, rp.rebin, rp.l_factor, rp.l_max_th, rp.l_factor1, rp.l_short_length, m_row_nthreads));
+      roi_refines[iset].reset(new ROI_refinement(ctx.tick_cmm(), m_nwires[0], m_nwires[1], m_nwires[2],rp.r_th_factor,rp.r_fake_signal_low_th,rp.r_fake_signal_high_th,rp.r_fake_signal_low_th_ind_factor,rp.r_fake_signal_high_th_ind_factor,rp.r_pad,rp.r_break_roi_loop,rp.r_th_peak,rp.r_sep_peak,rp.r_low_peak_sep_threshold_pre,rp.r_max_npeaks,rp.r_sigma,rp.r_th_percent));//
+      ROI_formation& roi_form = *roi_forms[iset];
+      ROI_refinement& roi_refine = *roi_refines[iset];
+
+      // Form tight ROIs
+      if (plane != 2){ // induction wire planes
+        roi_form.find_ROI_by_decon_itself(plane, work.r_tight, work.r_tighter);
+      }else{ // collection wire planes
+        roi_form.find_ROI_by_decon_itself(plane, work.r_tight);
+      }
+
+      // Form loose ROIs
+      if (plane != 2){
+        roi_form.find_ROI_loose(plane, work.r_loose);
+      }
+
+      // Refine ROIs
+      const Array::array_xxf& r_data = plane != 2 ? work.r_refine : work.r_tight;
+      roi_refine.load_data(plane, r_data, roi_form);
+      roi_refine.refine_data(plane, roi_form);
+
+      // Only rows with a refined ROI survive apply_roi() so only
+      // those need the outputs.
+      SignalROIChList& rois = plane == 0 ? roi_refine.get_u_rois()
+        : plane == 1 ? roi_refine.get_v_rois() : roi_refine.get_w_rois();
+      auto& roi_rows = work.sets[iset].roi_rows;
+      roi_rows.assign(m_nwires[plane], 0);
+      for (int iwire = 0; iwire < m_nwires[plane]; ++iwire) {
+        roi_rows[iwire] = !rois.at(iwire).empty();
+      }
+      if (m_sparse) {
+        roi_tick_ranges(rois, kern.nticks, work.sets[iset].roi_ranges);
+      }
+    });
+
+  // The outputs are needed where any set has an ROI.
+  auto& roi_rows = work.roi_rows;
+  roi_rows = work.sets[0].roi_rows;
+  for (int iset = 1; iset < nsets; ++iset) {
+    const auto& set_rows = work.sets[iset].roi_rows;
+    for (int iwire = 0; iwire < m_nwires[plane]; ++iwire) {
+      roi_rows[iwire] = roi_rows[iwire] || set_rows[iwire];
     }
   }
-  
-  //do the second round of inverse FFT on wire
-  Array::array_xxf tm_r_data = Array::idft_cr(c_data_afterfilter,0);
-  m_r_data = tm_r_data.block(m_pad_nwires[plane],0,m_nwires[plane],m_nticks);
-  if (plane==2) {
-    restore_baseline(m_r_data);
+
+  // merge results ...
+  if (kern.chunk_len <= 0) {
+    products.clear();
+    add_output_products(ctx, plane, products);
+    decon_2D(ctx, plane, products, &roi_rows);
+  }
+  for (int iset = 1; iset < nsets; ++iset) {
+    if (m_save_wiener) {
+      work.sets[iset].r_hits = work.sets[0].r_hits;
+    }
+    if (m_save_gauss) {
+      work.sets[iset].r_charge = work.sets[0].r_charge;
+    }
   }
+
+  parallel_for(nsets, m_sweep_nthreads, [&](int iset) {
+      ROI_formation& roi_form = *roi_forms[iset];
+      ROI_refinement& roi_refine = *roi_refines[iset];
+      PlaneWork::SetWork& sw = work.sets[iset];
+      PlaneTraces& pt = out[iset];
+
+      const std::vector<float>* perplane_thresholds[3] = {
+        &roi_form.get_uplane_rms(),
+        &roi_form.get_vplane_rms(),
+        &roi_form.get_wplane_rms()
+      };
+      const std::vector<float>& perwire_rmses = *perplane_thresholds[plane];
+
+      if (m_save_wiener) {
+        roi_refine.apply_roi(plane, sw.r_hits);
+        save_data(ctx, sw, pt.traces, pt.wiener, plane, sw.r_hits, perwire_rmses, pt.thresholds);
+      }
+
+      if (m_save_gauss) {
+        roi_refine.apply_roi(plane, sw.r_charge);
+        std::vector<double> dummy_thresholds;
+        save_data(ctx, sw, pt.traces, pt.gauss, plane, sw.r_charge, perwire_rmses, dummy_thresholds);
+      }
+    });
+
+  // The workspace is kept with the context for the next frame.
 }
 
-void OmnibusSigProc::decon_2D_charge(int plane){
-  // apply software filter on time
-  //std::cout << "Apply Time Filter! " << std::endl;
-  Waveform::realseq_t roi_hf_filter_wf;
-  if (plane ==0){
-    auto ncr1 = Factory::find<IFilterWaveform>("HfFilter","Gaus_wide");
-    roi_hf_filter_wf = ncr1->filter_waveform(m_c_data.cols());
-  }else if (plane==1){
-    auto ncr1 = Factory::find<IFilterWaveform>("HfFilter","Gaus_wide");
-    roi_hf_filter_wf = ncr1->filter_waveform(m_c_data.cols());
-  }else{
-    auto ncr1 = Factory::find<IFilterWaveform>("HfFilter","Gaus_wide");
-    roi_hf_filter_wf = ncr1->filter_waveform(m_c_data.cols());
-  }
-
-  Array::array_xxc c_data_afterfilter(m_c_data.rows(),m_c_data.cols());
-  for (int irow=0; irow<m_c_data.rows(); ++irow) {
-    for (int icol=0; icol<m_c_data.cols(); ++icol) {
-      c_data_afterfilter(irow,icol) = m_c_data(irow,icol) * roi_hf_filter_wf.at(icol);
+void OmnibusSigProc::configure_children(const WireCell::Configuration& config)
+{
+  for (size_t ind=0; ind < m_anodes_tn.size(); ++ind) {
+    Configuration cfg = config;
+    cfg["anodes"] = Json::arrayValue;
+    cfg["anode"] = m_anodes_tn[ind];
+    cfg["nthreads"] = 1;        // the threads are used across anodes
+    auto child = std::make_shared<OmnibusSigProc>();
+    child->configure(cfg);
+    // one tuner, and so one writer of the fft_table file, for all
+    child->m_fft_tuner = m_fft_tuner;
+    for (const auto& och : child->m_osp_chans) {
+      auto already = m_child_of_channel.find(och.ident);
+      if (already != m_child_of_channel.end() && already->second != (int)ind) {
+        THROW(ValueError() << errmsg{String::format("OmnibusSigProc: channel %d in both anode %s and %s",
+                                                    och.ident, m_anodes_tn[already->second], m_anodes_tn[ind])});
+      }
+      m_child_of_channel[och.ident] = ind;
     }
+    m_children.push_back(child);
   }
-  
-  //do the second round of inverse FFT on wire
-  Array::array_xxf tm_r_data = Array::idft_cr(c_data_afterfilter,0);
-  m_r_data = tm_r_data.block(m_pad_nwires[plane],0,m_nwires[plane],m_nticks);
-  if (plane==2) {
-    restore_baseline(m_r_data);
+}
+
+// Return the number of ticks spanned by the traces and set tbin0 to
+// the first.
+static int tick_span(const ITrace::vector& traces, int& tbin0)
+{
+  int tbinmin = 0, tbinmax = 0;
+  bool first = true;
+  for (auto trace : traces) {
+    const int tbin = trace->tbin();
+    const int nbins = trace->charge().size();
+    if (first) {
+      tbinmin = tbinmax = tbin;
+      first = false;
+    }
+    tbinmin = std::min(tbinmin, std::min(tbin, tbin+nbins));
+    tbinmax = std::max(tbinmax, std::max(tbin, tbin+nbins));
+  }
+  tbin0 = tbinmin;
+  return tbinmax-tbinmin;
+}
+
+bool OmnibusSigProc::process_children(const input_pointer& in, output_pointer& out)
+{
+  // Partition the input traces by anode.  The traces are shared,
+  // not copied.  Traces from other anodes are dropped.
+  const size_t nchildren = m_children.size();
+  std::vector<ITrace::vector> parts(nchildren);
+  for (auto trace : *in->traces()) {
+    auto it = m_child_of_channel.find(trace->channel());
+    if (it == m_child_of_channel.end()) {
+      continue;
+    }
+    parts[it->second].push_back(trace);
+  }
+
+  // Make the children's kernels one at a time before they run.  Any
+  // FFT lengths they need are then timed, by their shared tuner, on a
+  // machine not busy with the other anodes.  This is a lookup except
+  // when the readout changes.
+  for (size_t ind = 0; ind < nchildren; ++ind) {
+    if (!parts[ind].empty()) {
+      int tbin0 = 0;
+      m_children[ind]->kernels(in->tick(), tick_span(parts[ind], tbin0));
+    }
+  }
+
+  // An anode without traces in the frame adds nothing and its child
+  // is not run, so it keeps its kernels for the next frame.
+  std::vector<IFrame::pointer> outs(nchildren);
+  parallel_for(nchildren, m_nthreads, [&](int ind) {
+      if (parts[ind].empty()) {
+        return;
+      }
+      auto traces = new ITrace::vector;
+      traces->swap(parts[ind]);
+      input_pointer part(new SimpleFrame(in->ident(), in->time(),
+                                         ITrace::shared_vector(traces),
+                                         in->tick(), in->masks()));
+      (*m_children[ind])(part, outs[ind]);
+    });
+
+  // Merge in anode order so the output does not depend on threading.
+  // The tags are those of each ROI parameter set.
+  ITrace::vector* itraces = new ITrace::vector; // will become shared_ptr.
+  const int nsets = m_roi_sets.size();
+  std::vector<IFrame::trace_summary_t> thresholds(nsets);
+  std::vector<IFrame::trace_list_t> wiener_traces(nsets), gauss_traces(nsets);
+  Waveform::ChannelMaskMap cmm;
+  int nused = 0;
+  for (auto child_out : outs) {
+    if (!child_out) {
+      continue;
+    }
+    ++nused;
+    // keyed by channel ident so the anodes do not collide
+    for (const auto& cm : child_out->masks()) {
+      auto& masks = cmm[cm.first];
+      masks.insert(cm.second.begin(), cm.second.end());
+    }
+    const size_t offset = itraces->size();
+    auto traces = child_out->traces();
+    itraces->insert(itraces->end(), traces->begin(), traces->end());
+    for (int iset = 0; iset != nsets; ++iset) {
+      const std::string& suffix = m_roi_sets[iset].suffix;
+      for (auto ind : child_out->tagged_traces(m_wiener_tag + suffix)) {
+        wiener_traces[iset].push_back(ind + offset);
+      }
+      for (auto ind : child_out->tagged_traces(m_gauss_tag + suffix)) {
+        gauss_traces[iset].push_back(ind + offset);
+      }
+      const auto& summary = child_out->trace_summary(m_wiener_threshold_tag + suffix);
+      thresholds[iset].insert(thresholds[iset].end(), summary.begin(), summary.end());
+    }
+  }
+
+  // An anode without traces gives no masks, as a single anode OSP
+  // would give none for channels it does not have.
+  cmm["bad"];
+  cmm["lf_noisy"];
+  SimpleFrame* sframe = new SimpleFrame(in->ident(), in->time(),
+                                        ITrace::shared_vector(itraces),
+                                        in->tick(), cmm);
+  sframe->tag_frame(m_frame_tag);
+
+  for (int iset = 0; iset != nsets; ++iset) {
+    const std::string& suffix = m_roi_sets[iset].suffix;
+    sframe->tag_traces(m_wiener_tag + suffix, wiener_traces[iset]);
+    sframe->tag_traces(m_wiener_threshold_tag + suffix, wiener_traces[iset], thresholds[iset]);
+    sframe->tag_traces(m_gauss_tag + suffix, gauss_traces[iset]);
+  }
+
+  std::cerr << "OmnibusSigProc: produce " << itraces->size() << " traces from "
+            << nused << " of " << nchildren << " anodes\n";
+
+  out = IFrame::pointer(sframe);
+  return true;
+}
+
+std::unique_ptr<OmnibusSigProc::Context> OmnibusSigProc::acquire_context()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_contexts.empty()) {
+    return std::unique_ptr<Context>(new Context);
   }
+  std::unique_ptr<Context> ctx = std::move(m_contexts.back());
+  m_contexts.pop_back();
+  return ctx;
 }
 
+void OmnibusSigProc::release_context(std::unique_ptr<Context> ctx)
+{
+  // Drop the frame's data but keep the working memory.
+  ctx->kern = nullptr;
+  ctx->cmm.clear();
+  ctx->shifted_cmm.clear();
+  for (int iplane = 0; iplane < 3; ++iplane) {
+    ctx->work[iplane].in_traces.clear();
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_contexts.push_back(std::move(ctx));
+}
 
 bool OmnibusSigProc::operator()(const input_pointer& in, output_pointer& out)
 {
@@ -1009,120 +1539,117 @@ bool OmnibusSigProc::operator()(const input_pointer& in, output_pointer& out)
     return true;
   }
 
+  if (!m_children.empty()) {
+    return process_children(in, out);
+  }
+
+  // Each call works in its own context so several frames may be
+  // processed at once.
+  std::unique_ptr<Context> pctx = acquire_context();
+  Context& ctx = *pctx;
+
   // Convert to OSP cmm indexed by OSB sequential channels, NOT WCT channel ID.
-  m_cmm.clear();
+  ctx.cmm.clear();
   // double emap: name -> channel -> pair<int,int>
   for (auto cm : in->masks()) {
     const std::string name = cm.first;
     for (auto m: cm.second) {
       const int wct_channel_ident = m.first;
-      const OspChan& och = m_channel_map[wct_channel_ident];
-      if (och.plane < 0) {
+      const int ind = m_chindex->index(wct_channel_ident);
+      if (ind < 0) {
         continue;               // in case user gives us multi apa frame
       }
-      m_cmm[name][och.channel] = m.second;
+      const OspChan& och = m_osp_chans[ind];
+      ctx.cmm[name][och.channel] = m.second;
       //std::cerr << wct_channel_ident << " " << och.str() << std::endl;
     }
   }
+  // The plane workers only read the cmm.  Make sure the masks they
+  // look up exist so they are in the output frame as before.
+  ctx.cmm["bad"];
+  ctx.cmm["lf_noisy"];
 
-  ITrace::vector* itraces = new ITrace::vector; // will become shared_ptr.
-  IFrame::trace_summary_t thresholds;
-  IFrame::trace_list_t wiener_traces, gauss_traces, perframe_traces[3];
+  // The readout spans the ticks of all traces.
+  const int nticks = tick_span(*in->traces(), ctx.tbin0);
+  std::cerr <<"OmnibusSigProc: nticks=" << nticks << " tbinmin="<<ctx.tbin0 << " tbinmax="<<ctx.tbin0+nticks<<std::endl;
 
   // initialize the overall response function ... 
-  init_overall_response(in);
-
-  // create a class for ROIs ... 
-  ROI_formation roi_form(m_cmm, m_nwires[0], m_nwires[1], m_nwires[2], m_nticks, m_th_factor_ind, m_th_factor_col, m_pad, m_asy, m_rebin, m_l_factor, m_l_max_th, m_l_factor1, m_l_short_length);
-  ROI_refinement roi_refine(m_cmm, m_nwires[0], m_nwires[1], m_nwires[2],m_r_th_factor,m_r_fake_signal_low_th,m_r_fake_signal_high_th,m_r_fake_signal_low_th_ind_factor,m_r_fake_signal_high_th_ind_factor,m_r_pad,m_r_break_roi_loop,m_r_th_peak,m_r_sep_peak,m_r_low_peak_sep_threshold_pre,m_r_max_npeaks,m_r_sigma,m_r_th_percent);//
-
-  
-  const std::vector<float>* perplane_thresholds[3] = {
-    &roi_form.get_uplane_rms(),
-    &roi_form.get_vplane_rms(),
-    &roi_form.get_wplane_rms()
-  };
-
-
-  for (int iplane = 0; iplane != 3; ++iplane){
-    const std::vector<float>& perwire_rmses = *perplane_thresholds[iplane];
-
-    // load data into EIGEN matrices ...
-    load_data(in, iplane); // load into a large matrix
-    // initial decon ... 
-    decon_2D_init(iplane); // decon in large matrix
-    // std::cout << "initialize decon ..." << std::endl;
-
-    //std::cout << "Form tight ROIs " << i  << std::endl;
-    // Form tight ROIs
-    if (iplane != 2){ // induction wire planes
-      decon_2D_tighterROI(iplane);
-      Array::array_xxf r_data_tight = m_r_data;
-      //      r_data_tight = m_r_data;
-      decon_2D_tightROI(iplane);
-      roi_form.find_ROI_by_decon_itself(iplane, m_r_data, r_data_tight);
-    }else{ // collection wire planes
-      decon_2D_tightROI(iplane);
-      roi_form.find_ROI_by_decon_itself(iplane, m_r_data);
+  ctx.kern = kernels(in->tick(), nticks);
+  const Kernels& kern = *ctx.kern;
+  for (int iplane = 0; iplane < 3; ++iplane) {
+    if (!m_do_plane[iplane]) {
+      continue;
     }
-    //    std::cout << "Form tight ROIs " << iplane  << std::endl;
-    
-    // Form loose ROIs
-    if (iplane != 2){
-      decon_2D_looseROI(iplane);
-
-      roi_form.find_ROI_loose(iplane,m_r_data);
-      decon_2D_ROI_refine(iplane);
+    // keep the engine, and so its plans, while the shape holds
+    auto& fft = ctx.fft[iplane];
+    if (!fft || fft->nrows() != kern.fft_nwires[iplane] || fft->ncols() != kern.fft_nticks) {
+      fft = FFTEngine::make(m_fft_backend, kern.fft_nwires[iplane], kern.fft_nticks);
     }
+  }
 
-    // Refine ROIs
-    roi_refine.load_data(iplane, m_r_data, roi_form);
-    roi_refine.refine_data(iplane, roi_form);
-
-    // merge results ...
-    decon_2D_hits(iplane);
-    roi_refine.apply_roi(iplane, m_r_data);
-    save_data(*itraces, perframe_traces[iplane], iplane, perwire_rmses, thresholds);
-    wiener_traces.insert(wiener_traces.end(), perframe_traces[iplane].begin(), perframe_traces[iplane].end());
+  // sort the input by plane once for all planes and chunks
+  bucket_input(ctx, in);
 
-    decon_2D_charge(iplane);
-    roi_refine.apply_roi(iplane, m_r_data);
-    std::vector<double> dummy_thresholds;
-    save_data(*itraces, gauss_traces, iplane, perwire_rmses, dummy_thresholds);
+  // Run the per-plane pipelines, concurrently if so configured.
+  std::vector<PlaneTraces> plane_traces[3];
+  parallel_for(3, m_nthreads, [&](int iplane) {
+      if (m_do_plane[iplane]) {
+        process_plane(ctx, iplane, plane_traces[iplane]);
+      }
+    });
 
-    m_c_data.resize(0,0); // clear memory
-    m_r_data.resize(0,0); // clear memory
+  // Merge in set and plane order so the output does not depend on
+  // threading.
+  ITrace::vector* itraces = new ITrace::vector; // will become shared_ptr.
+  const int nsets = m_roi_sets.size();
+  std::vector<IFrame::trace_summary_t> thresholds(nsets);
+  std::vector<IFrame::trace_list_t> wiener_traces(nsets), gauss_traces(nsets);
+  for (int iset = 0; iset != nsets; ++iset) {
+    for (int iplane = 0; iplane != 3; ++iplane){
+      if (plane_traces[iplane].empty()) {
+        continue;               // not selected
+      }
+      auto& pt = plane_traces[iplane][iset];
+      const size_t offset = itraces->size();
+      itraces->insert(itraces->end(), pt.traces.begin(), pt.traces.end());
+      for (auto ind : pt.wiener) {
+        wiener_traces[iset].push_back(ind + offset);
+      }
+      for (auto ind : pt.gauss) {
+        gauss_traces[iset].push_back(ind + offset);
+      }
+      thresholds[iset].insert(thresholds[iset].end(), pt.thresholds.begin(), pt.thresholds.end());
+    }
   }
 
+  // The output masks are keyed by WCT channel ident, as are the
+  // traces, and only hold the channels of this anode.
+  Waveform::ChannelMaskMap out_cmm;
+  for (const auto& cm : ctx.cmm) {
+    auto& masks = out_cmm[cm.first];
+    for (const auto& m : cm.second) {
+      masks[m_osp_chans[m.first].ident] = m.second;
+    }
+  }
   SimpleFrame* sframe = new SimpleFrame(in->ident(), in->time(),
                                         ITrace::shared_vector(itraces),
-                                        in->tick(), m_cmm);
+                                        in->tick(), out_cmm);
   sframe->tag_frame(m_frame_tag);
 
-  // this assumes save_data produces itraces in OSP channel order
-  // std::vector<float> perplane_thresholds[3] = {
-  //   roi_form.get_uplane_rms(),
-  //   roi_form.get_vplane_rms(),
-  //   roi_form.get_wplane_rms()
-  // };
+  std::cerr << "OmnibusSigProc: produce " << itraces->size() << " traces\n";
+  for (int iset = 0; iset != nsets; ++iset) {
+    const std::string& suffix = m_roi_sets[iset].suffix;
+    sframe->tag_traces(m_wiener_tag + suffix, wiener_traces[iset]);
+    sframe->tag_traces(m_wiener_threshold_tag + suffix, wiener_traces[iset], thresholds[iset]);
+    sframe->tag_traces(m_gauss_tag + suffix, gauss_traces[iset]);
 
-  // IFrame::trace_summary_t threshold;
-  // for (int iplane=0; iplane<3; ++iplane) {
-  //   for (float val : perplane_thresholds[iplane]) {
-  //     threshold.push_back((double)val);
-  //   }
-  // }
-
-  sframe->tag_traces(m_wiener_tag, wiener_traces);
-  sframe->tag_traces(m_wiener_threshold_tag, wiener_traces, thresholds);
-  sframe->tag_traces(m_gauss_tag, gauss_traces);
-
-  std::cerr << "OmnibusSigProc: produce " << itraces->size() << " traces\n"
-	    << "\t" << wiener_traces.size() << " " << m_wiener_tag << " \n"
-	    << "\t" << gauss_traces.size() << " " << m_gauss_tag << " \n";
+    std::cerr << "\t" << wiener_traces[iset].size() << " " << m_wiener_tag + suffix << " \n"
+              << "\t" << gauss_traces[iset].size() << " " << m_gauss_tag + suffix << " \n";
+  }
 
   out = IFrame::pointer(sframe);
-  
+
+  release_context(std::move(pctx));
   return true;
 }
 
@@ -0,0 +1,78 @@
+#ifndef WIRECELLSIGPROC_PARALLEL
+#define WIRECELLSIGPROC_PARALLEL
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace WireCell {
+  namespace SigProc {
+
+    // Split [0,n) into at most nthreads contiguous chunks and call
+    // func(ithread, begin, end) for each, one chunk per thread.  The
+    // calling thread runs the first chunk itself.  With nthreads <= 1
+    // this is a plain function call.  The first exception thrown by
+    // any chunk is rethrown after all threads are joined.
+    template<typename Func>
+    void parallel_chunks(int n, int nthreads, Func func)
+    {
+      if (n <= 0) {
+        return;
+      }
+      nthreads = std::max(1, std::min(nthreads, n));
+      if (nthreads == 1) {
+        func(0, 0, n);
+        return;
+      }
+
+      std::vector<std::exception_ptr> errors(nthreads);
+      auto run = [&](int ithread, int beg, int end) {
+        try {
+          func(ithread, beg, end);
+        }
+        catch (...) {
+          errors[ithread] = std::current_exception();
+        }
+      };
+
+      const int chunk = n / nthreads;
+      const int extra = n % nthreads;
+      std::vector<std::thread> threads;
+      threads.reserve(nthreads-1);
+      int beg = chunk + (extra > 0 ? 1 : 0);
+      for (int ithread = 1; ithread < nthreads; ++ithread) {
+        const int end = beg + chunk + (ithread < extra ? 1 : 0);
+        threads.emplace_back(run, ithread, beg, end);
+        beg = end;
+      }
+      run(0, 0, chunk + (extra > 0 ? 1 : 0));
+      for (auto& th : threads) {
+        th.join();
+      }
+      for (auto& err : errors) {
+        if (err) {
+          std::rethrow_exception(err);
+        }
+      }
+    }
+
+    // Call func(i) for every i in [0,n) spread over nthreads threads.
+    template<typename Func>
+    void parallel_for(int n, int nthreads, Func func)
+    {
+      parallel_chunks(n, nthreads, [&](int /*ithread*/, int beg, int end) {
+          for (int ind = beg; ind < end; ++ind) {
+            func(ind);
+          }
+        });
+    }
+
+  }
+}
+
+#endif
+// Local Variables:
+// mode: c++
+// c-basic-offset: 2
+// End:
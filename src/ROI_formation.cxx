@@ -1,12 +1,14 @@
 
 #include "ROI_formation.h"
+#include "ROI_index.h"
+#include "Parallel.h"
 
 #include <iostream>
 
 using namespace WireCell;
 using namespace WireCell::SigProc;
 
-ROI_formation::ROI_formation(Waveform::ChannelMaskMap& cmm,int nwire_u, int nwire_v, int nwire_w, int nbins, float th_factor_ind, float th_factor_col, int pad, float asy, int rebin , double l_factor, double l_max_th, double l_factor1, int l_short_length)
+ROI_formation::ROI_formation(const Waveform::ChannelMaskMap& cmm,int nwire_u, int nwire_v, int nwire_w, int nbins, float th_factor_ind, float th_factor_col, int pad, float asy, int rebin , double l_factor, double l_max_th, double l_factor1, int l_short_length, int nthreads)
   : nwire_u(nwire_u)
   , nwire_v(nwire_v)
   , nwire_w(nwire_w)
@@ -20,6 +22,7 @@ ROI_formation::ROI_formation(Waveform::ChannelMaskMap& cmm,int nwire_u, int nwir
   , l_max_th(l_max_th)
   , l_factor1(l_factor1)
   , l_short_length(l_short_length)
+  , nthreads(nthreads)
 {
   self_rois_u.resize(nwire_u);
   self_rois_v.resize(nwire_v);
@@ -33,13 +36,16 @@ ROI_formation::ROI_formation(Waveform::ChannelMaskMap& cmm,int nwire_u, int nwir
   vplane_rms.resize(nwire_v);
   wplane_rms.resize(nwire_w);
 
-  for (auto it = cmm["bad"].begin(); it!=cmm["bad"].end(); it++){
-    int ch = it->first;
-    std::vector<std::pair<int,int>> temps;
-    bad_ch_map[ch] = temps;
-    for (size_t ind = 0; ind < it->second.size(); ind++){
-      bad_ch_map[ch].push_back(std::make_pair(it->second.at(ind).first, it->second.at(ind).second));
-      //std::cout << ch << " " <<  << std::endl;
+  auto badit = cmm.find("bad");
+  if (badit != cmm.end()) {
+    for (auto it = badit->second.begin(); it!=badit->second.end(); it++){
+      int ch = it->first;
+      std::vector<std::pair<int,int>> temps;
+      bad_ch_map[ch] = temps;
+      for (size_t ind = 0; ind < it->second.size(); ind++){
+        bad_ch_map[ch].push_back(std::make_pair(it->second.at(ind).first, it->second.at(ind).second));
+        //std::cout << ch << " " <<  << std::endl;
+      }
     }
   }
   //std::cout << bad_ch_map.size() << std::endl;
@@ -146,126 +152,78 @@ void ROI_formation::extend_ROI_self(int plane){
 
 void ROI_formation::create_ROI_connect_info(int plane){
 
+  std::vector<std::vector<std::pair<int,int>>>* prois = 0;
+  int nwire = 0;
   if (plane==0){
-    // u 
-    for (int i=0;i!=nwire_u-2;i++){
-      for (size_t j=0; j!=self_rois_u.at(i).size();j++){
-	int start1 = self_rois_u.at(i).at(j).first;
-	int end1 = self_rois_u.at(i).at(j).second;
-	int length1 = end1-start1+1;
-	for (size_t k=0; k!=self_rois_u.at(i+2).size();k++){
-	  int start2 = self_rois_u.at(i+2).at(k).first;
-	  int end2 = self_rois_u.at(i+2).at(k).second;
-	  int length2 = end2 - start2 + 1;
-	  if ( fabs(length2 - length1) < (length2 + length1) * asy){
-	    int start3 = (start1+start2)/2.;
-	    int end3 = (end1+end2)/2.;
-	    if (start3 < end3 && start3 <= end1 && start3 <=end2 && end3 >= start1 && end3 >=start2){
-	      // go through existing ones to make sure there is no overlap
-	      int flag = 0; 
-	      for (size_t i1 = 0; i1!=self_rois_u.at(i+1).size();i1++){
-		int max_start = start3;
-		if (self_rois_u.at(i+1).at(i1).first > max_start)
-		  max_start = self_rois_u.at(i+1).at(i1).first;
-		int min_end = end3;
-		if (self_rois_u.at(i+1).at(i1).second < min_end)
-		  min_end = self_rois_u.at(i+1).at(i1).second ;
-		if (max_start < min_end){
-		  flag = 1;
-		  break;
-		}
-	      }
-	      if (flag == 0)
-		self_rois_u.at(i+1).push_back(std::make_pair(start3,end3));
-	    }
-	  }
-	} 
-      }
-    }
+    // u
+    prois = &self_rois_u;
+    nwire = nwire_u;
   }else if (plane==1){
     // v
-    for (int i=0;i!=nwire_v-2;i++){
-      for (size_t j=0; j!=self_rois_v.at(i).size();j++){
-	int start1 = self_rois_v.at(i).at(j).first;
-	int end1 = self_rois_v.at(i).at(j).second;
-	int length1 = end1-start1+1;
-	for (size_t k=0; k!=self_rois_v.at(i+2).size();k++){
-	  int start2 = self_rois_v.at(i+2).at(k).first;
-	  int end2 = self_rois_v.at(i+2).at(k).second;
-	  int length2 = end2 - start2 + 1;
-	  if ( fabs(length2 - length1) < (length2 + length1) * asy){
-	    int start3 = (start1+start2)/2.;
-	    int end3 = (end1+end2)/2.;
-	    if (start3 < end3 && start3 <= end1 && start3 <=end2 && end3 >= start1 && end3 >=start2){
-	      // go through existing ones to make sure there is no overlap
-	      int flag = 0; 
-	      for (size_t i1 = 0; i1!=self_rois_v.at(i+1).size();i1++){
-		int max_start = start3;
-		if (self_rois_v.at(i+1).at(i1).first > max_start)
-		  max_start = self_rois_v.at(i+1).at(i1).first;
-		int min_end = end3;
-		if (self_rois_v.at(i+1).at(i1).second < min_end)
-		  min_end = self_rois_v.at(i+1).at(i1).second ;
-		if (max_start < min_end){
-		  flag = 1;
-		  break;
-		}
-	      }
-	      if (flag == 0)
-		self_rois_v.at(i+1).push_back(std::make_pair(start3,end3));
-	    }
-	  }
-	} 
-      }
-    }
+    prois = &self_rois_v;
+    nwire = nwire_v;
   }else if (plane==2){
     // w?
-    for (int i=0;i!=nwire_w-2;i++){
-      for (size_t j=0; j!=self_rois_w.at(i).size();j++){
-	int start1 = self_rois_w.at(i).at(j).first;
-	int end1 = self_rois_w.at(i).at(j).second;
-	int length1 = end1-start1+1;
-	for (size_t k=0; k!=self_rois_w.at(i+2).size();k++){
-	  int start2 = self_rois_w.at(i+2).at(k).first;
-	  int end2 = self_rois_w.at(i+2).at(k).second;
-	  int length2 = end2 - start2 + 1;
-	  if ( fabs(length2 - length1) < (length2 + length1) * asy){
-	    int start3 = (start1+start2)/2.;
-	    int end3 = (end1+end2)/2.;
-	    if (start3 < end3 && start3 <= end1 && start3 <=end2 && end3 >= start1 && end3 >=start2){
-	      // go through existing ones to make sure there is no overlap
-	      int flag = 0; 
-	      for (size_t i1 = 0; i1!=self_rois_w.at(i+1).size();i1++){
-		int max_start = start3;
-		if (self_rois_w.at(i+1).at(i1).first > max_start)
-		  max_start = self_rois_w.at(i+1).at(i1).first;
-		int min_end = end3;
-		if (self_rois_w.at(i+1).at(i1).second < min_end)
-		  min_end = self_rois_w.at(i+1).at(i1).second ;
-		if (max_start < min_end){
-		  flag = 1;
-		  break;
-		}
-	      }
-	      if (flag == 0)
-		self_rois_w.at(i+1).push_back(std::make_pair(start3,end3));
+    prois = &self_rois_w;
+    nwire = nwire_w;
+  }else{
+    return;
+  }
+  std::vector<std::vector<std::pair<int,int>>>& rois = *prois;
+
+  // A ROI is added on wire i+1 between similar ROIs on wires i and
+  // i+2 unless it overlaps one already there.  Wires i+1 and i+2 are
+  // indexed by start tick so only ROIs near each other are compared.
+  // The pairs are still tried in the order of a loop over the ROIs of
+  // wire i and then of wire i+2, as the ROIs added on wire i+1 take
+  // part in the later overlap tests.
+  ROI_index mid_index, far_index;
+  std::vector<int> cands;
+  if (nwire > 2){
+    for (size_t k=0; k!=rois.at(1).size(); k++){
+      far_index.insert(rois.at(1).at(k).first, rois.at(1).at(k).second, k);
+    }
+  }
+  for (int i=0;i<nwire-2;i++){
+    std::swap(mid_index, far_index);
+    far_index.clear();
+    for (size_t k=0; k!=rois.at(i+2).size(); k++){
+      far_index.insert(rois.at(i+2).at(k).first, rois.at(i+2).at(k).second, k);
+    }
+    for (size_t j=0; j!=rois.at(i).size();j++){
+      int start1 = rois.at(i).at(j).first;
+      int end1 = rois.at(i).at(j).second;
+      int length1 = end1-start1+1;
+      // start3 <= end1 and end3 >= start1 below bound the start of
+      // the ROI on wire i+2
+      cands.clear();
+      far_index.starts_between(2*start1 - end1 - 1 - far_index.max_length(), 2*end1 - start1 + 1, cands);
+      std::sort(cands.begin(), cands.end());
+      for (int k : cands){
+	int start2 = rois.at(i+2).at(k).first;
+	int end2 = rois.at(i+2).at(k).second;
+	int length2 = end2 - start2 + 1;
+	if ( fabs(length2 - length1) < (length2 + length1) * asy){
+	  int start3 = (start1+start2)/2.;
+	  int end3 = (end1+end2)/2.;
+	  if (start3 < end3 && start3 <= end1 && start3 <=end2 && end3 >= start1 && end3 >=start2){
+	    // make sure there is no overlap with existing ones
+	    if (!mid_index.overlaps(start3, end3)){
+	      mid_index.insert(start3, end3, rois.at(i+1).size());
+	      rois.at(i+1).push_back(std::make_pair(start3,end3));
 	    }
 	  }
-	} 
+	}
       }
     }
   }
 }
 
-double ROI_formation::cal_RMS(Waveform::realseq_t signal){
+double ROI_formation::cal_RMS(const Waveform::realseq_t& signal, RobustStats& stats){
   double result = 0;
   if (signal.size()>0){
     // do quantile ... 
-    float par[3];
-    par[0] = WireCell::Waveform::percentile_binned(signal,0.5 - 0.34);
-    par[1] = WireCell::Waveform::percentile_binned(signal,0.5);
-    par[2] = WireCell::Waveform::percentile_binned(signal,0.5 + 0.34);
-    float rms = sqrt((pow(par[2]-par[1],2)+pow(par[1]-par[0],2))/2.);
+    float rms = stats.percentile_rms(signal.data(), signal.size());
 
     float rms2 = 0;
     float rms1 = 0;
@@ -283,30 +241,24 @@ double ROI_formation::cal_RMS(Waveform::realseq_t signal){
   return result;
 }
 
-void ROI_formation::find_ROI_by_decon_itself(int plane, const Array::array_xxf& r_data, const Array::array_xxf& r_data_tight){
-
-  int offset=0;
-  if (plane==0){
-    offset = 0;
-  }else if (plane==1){
-    offset = nwire_u;
-  }else if (plane==2){
-    offset = nwire_u + nwire_v;
-  }
-  
-  for (int irow = 0; irow!=r_data.rows(); irow++){
-    // calclulate rms for a row of r_data
-    Waveform::realseq_t signal(nbins);
-    Waveform::realseq_t signal1(nbins);
-    Waveform::realseq_t signal2(nbins);
+void ROI_formation::find_ROI_self_row(int plane, int irow, int offset, const Array::array_xxf& r_data, const Array::array_xxf& r_data_tight, RowScratch& scratch){
+    // calclulate rms for a row of r_data, in the thread's buffers
+    Waveform::realseq_t& signal = scratch.signal;
+    Waveform::realseq_t& signal1 = scratch.signal1;
+    Waveform::realseq_t& signal2 = scratch.signal2;
+    signal.assign(nbins, 0);
+    signal1.assign(nbins, 0);
+    signal2.assign(nbins, 0);
     
-    if (bad_ch_map.find(irow+offset)!=bad_ch_map.end()){
+    auto badit = bad_ch_map.find(irow+offset);
+    if (badit != bad_ch_map.end()){
+      const auto& bad_ranges = badit->second;
       int ncount = 0;
       for (int icol=0;icol!=r_data.cols();icol++){
 	bool flag = true;
-	for (size_t i=0; i!=bad_ch_map[irow+offset].size(); i++){
-	  if (icol >= bad_ch_map[irow+offset].at(i).first &&
-	      icol <= bad_ch_map[irow+offset].at(i).second){
+	for (size_t i=0; i!=bad_ranges.size(); i++){
+	  if (icol >= bad_ranges.at(i).first &&
+	      icol <= bad_ranges.at(i).second){
 	    flag = false;
 	    break;
 	  }
@@ -330,7 +282,7 @@ void ROI_formation::find_ROI_by_decon_itself(int plane, const Array::array_xxf&
       }
     }
     // do threshold and fill rms 
-    double rms = cal_RMS(signal);
+    double rms = cal_RMS(signal, scratch.stats);
     double threshold = 0;
     if (plane==0){
       threshold = th_factor_ind * rms + 1;
@@ -405,8 +357,32 @@ void ROI_formation::find_ROI_by_decon_itself(int plane, const Array::array_xxf&
       self_rois_w.at(irow) = temp_rois;
     }
     //    std::cout << plane << " " << irow << " " << temp_rois.size() << std::endl;
+}
+
+void ROI_formation::find_ROI_by_decon_itself(int plane, const Array::array_xxf& r_data, const Array::array_xxf& r_data_tight){
+
+  int offset=0;
+  if (plane==0){
+    offset = 0;
+  }else if (plane==1){
+    offset = nwire_u;
+  }else if (plane==2){
+    offset = nwire_u + nwire_v;
   }
   
+  // Rows are independent and only write their own slots.  Each
+  // thread reuses its own buffers.
+  const int nrows = r_data.rows();
+  const int nthr = std::max(1, std::min(nthreads, nrows));
+  if ((int)row_scratch.size() < nthr) {
+    row_scratch.resize(nthr);
+  }
+  parallel_chunks(nrows, nthr, [&](int ithread, int beg, int end) {
+      for (int irow = beg; irow < end; ++irow) {
+        find_ROI_self_row(plane, irow, offset, r_data, r_data_tight, row_scratch[ithread]);
+      }
+    });
+  
   extend_ROI_self(plane);
 
   // for (size_t i=0;i!=self_rois_w.at(69).size();i++){
@@ -568,33 +544,25 @@ int ROI_formation::find_ROI_begin(Waveform::realseq_t& signal, int bin, double t
 }
 
 
-void ROI_formation::find_ROI_loose(int plane, const Array::array_xxf& r_data){
-  int offset=0;
-  if (plane==0){
-    offset = 0;
-  }else if (plane==1){
-    offset = nwire_u;
-  }else if (plane==2){
-    offset = nwire_u + nwire_v;
-  }
-  
- 
-  
-  // form rebinned waveform ... 
-  for (int irow =0; irow!=r_data.rows();irow++){
-    Waveform::realseq_t signal(nbins); // remove bad ones
-    Waveform::realseq_t signal1(nbins); // all signal
-    Waveform::realseq_t signal2(int(nbins/rebin)); // rebinned ones
+void ROI_formation::find_ROI_loose_row(int plane, int irow, int offset, const Array::array_xxf& r_data, RowScratch& scratch){
+    Waveform::realseq_t& signal = scratch.signal; // remove bad ones
+    Waveform::realseq_t& signal1 = scratch.signal1; // all signal
+    Waveform::realseq_t& signal2 = scratch.signal2; // rebinned ones
+    signal.assign(nbins, 0);
+    signal1.assign(nbins, 0);
+    signal2.assign(int(nbins/rebin), 0);
 
     //std::cout << "xin1" << std::endl;
     
-    if (bad_ch_map.find(irow+offset)!=bad_ch_map.end()){
+    auto badit = bad_ch_map.find(irow+offset);
+    if (badit != bad_ch_map.end()){
+      const auto& bad_ranges = badit->second;
       int ncount = 0;
       for (int icol=0;icol!=r_data.cols();icol++){
 	bool flag = true;
-	for (size_t i=0; i!=bad_ch_map[irow+offset].size(); i++){
-	  if (icol >= bad_ch_map[irow+offset].at(i).first &&
-	      icol <= bad_ch_map[irow+offset].at(i).second){
+	for (size_t i=0; i!=bad_ranges.size(); i++){
+	  if (icol >= bad_ranges.at(i).first &&
+	      icol <= bad_ranges.at(i).second){
 	    flag = false;
 	    break;
 	  }
@@ -629,7 +597,7 @@ void ROI_formation::find_ROI_loose(int plane, const Array::array_xxf& r_data){
     //std::cout << "xin3" << " " << signal.size() << " " << signal2.size() << std::endl;
     
     // calculate rms ...
-    float th = cal_RMS(signal) * rebin * l_factor;
+    float th = cal_RMS(signal, scratch.stats) * rebin * l_factor;
     //if (irow==1240) std::cout << "a " << l_factor << " " << rebin << " " << th << " " << l_max_th << std::endl;
     if (th > l_max_th) th = l_max_th;
     
@@ -808,7 +776,33 @@ void ROI_formation::find_ROI_loose(int plane, const Array::array_xxf& r_data){
        loose_rois_w.at(irow) = ROIs_1;
      }
      //std::cout << plane << " " << irow << " " << ROIs_1.size() << std::endl;
+}
+
+void ROI_formation::find_ROI_loose(int plane, const Array::array_xxf& r_data){
+  int offset=0;
+  if (plane==0){
+    offset = 0;
+  }else if (plane==1){
+    offset = nwire_u;
+  }else if (plane==2){
+    offset = nwire_u + nwire_v;
+  }
+  
+ 
+  
+  // form rebinned waveform ... 
+  // Rows are independent and only write their own slots.  Each
+  // thread reuses its own buffers.
+  const int nrows = r_data.rows();
+  const int nthr = std::max(1, std::min(nthreads, nrows));
+  if ((int)row_scratch.size() < nthr) {
+    row_scratch.resize(nthr);
   }
+  parallel_chunks(nrows, nthr, [&](int ithread, int beg, int end) {
+      for (int irow = beg; irow < end; ++irow) {
+        find_ROI_loose_row(plane, irow, offset, r_data, row_scratch[ithread]);
+      }
+    });
   
   //  std::cout << "xin6" << std::endl;
   
@@ -6,6 +6,8 @@
 #include "WireCellUtil/Array.h"
 #include "WireCellUtil/Waveform.h"
 
+#include "WireCellSigProc/RobustStats.h"
+
 #include <vector>
 #include <map>
 
@@ -13,7 +15,7 @@ namespace WireCell{
   namespace SigProc{
     class ROI_formation{
     public:
-      ROI_formation(Waveform::ChannelMaskMap& cmm,int nwire_u, int nwire_v, int nwire_w, int nbins = 9594, float th_factor_ind = 3, float th_factor_col = 5, int pad = 5, float asy = 0.1, int rebin =6, double l_factor=3.5, double l_max_th=10000, double l_factor1=0.7, int l_short_length = 3);
+      ROI_formation(const Waveform::ChannelMaskMap& cmm,int nwire_u, int nwire_v, int nwire_w, int nbins = 9594, float th_factor_ind = 3, float th_factor_col = 5, int pad = 5, float asy = 0.1, int rebin =6, double l_factor=3.5, double l_max_th=10000, double l_factor1=0.7, int l_short_length = 3, int nthreads = 1);
       ~ROI_formation();
 
       void Clear();
@@ -56,11 +58,21 @@ namespace WireCell{
       
       
     private:
-      double cal_RMS(Waveform::realseq_t signal);
+      double cal_RMS(const Waveform::realseq_t& signal, RobustStats& stats);
       double local_ave(Waveform::realseq_t& signal, int bin, int width);
       int find_ROI_end(Waveform::realseq_t& signal, int bin, double th = 0); 
       int find_ROI_begin(Waveform::realseq_t& signal, int bin, double th = 0); 
 
+      // per thread buffers for the row-wise ROI finding
+      struct RowScratch {
+        Waveform::realseq_t signal, signal1, signal2;
+        RobustStats stats;
+      };
+      std::vector<RowScratch> row_scratch;
+      // find the ROIs of one row, see find_ROI_by_decon_itself() and find_ROI_loose()
+      void find_ROI_self_row(int plane, int irow, int offset, const Array::array_xxf& r_data, const Array::array_xxf& r_data_tight, RowScratch& scratch);
+      void find_ROI_loose_row(int plane, int irow, int offset, const Array::array_xxf& r_data, RowScratch& scratch);
+
       
       int nwire_u, nwire_v, nwire_w;
       int nbins;
@@ -77,6 +89,9 @@ namespace WireCell{
       double l_factor1;
       int l_short_length;
 
+      // number of threads over which the rows are spread
+      int nthreads;
+
      
       
 
@@ -0,0 +1,93 @@
+#ifndef WIRECELLSIGPROC_ROIINDEX
+#define WIRECELLSIGPROC_ROIINDEX
+
+#include <algorithm>
+#include <vector>
+
+namespace WireCell {
+  namespace SigProc {
+
+    // The tick ranges of the ROIs of one wire ordered by start tick,
+    // for finding which of them overlap a range from a neighbouring
+    // wire without scanning them all.  Ranges are [start, end] with
+    // inclusive ends and are told apart by an index given on insert,
+    // usually their position in the wire's list of ROIs.  A query
+    // only looks at the ranges starting within the longest range of
+    // the wire before the queried one, so the cost follows the number
+    // of nearby ROIs rather than all ROIs on the wire.
+    class ROI_index {
+    public:
+      struct Range {
+        int start, end, index;
+      };
+
+      void clear() {
+        m_ranges.clear();
+        m_max_length = 0;
+      }
+
+      bool empty() const { return m_ranges.empty(); }
+
+      // Add a range, after any others with the same start.
+      void insert(int start, int end, int index) {
+        auto it = std::upper_bound(m_ranges.begin(), m_ranges.end(), start,
+                                   [](int s, const Range& r) { return s < r.start; });
+        m_ranges.insert(it, Range{start, end, index});
+        m_max_length = std::max(m_max_length, end - start);
+      }
+
+      // Append to hits the index of each range starting in
+      // [smin, smax], in order of start.
+      void starts_between(int smin, int smax, std::vector<int>& hits) const {
+        auto it = first_start(smin);
+        for (; it != m_ranges.end() && it->start <= smax; ++it) {
+          hits.push_back(it->index);
+        }
+      }
+
+      // Longest end - start over the ranges.
+      int max_length() const { return m_max_length; }
+
+      // True if any range overlaps [start, end] by more than a shared
+      // end point, the test of SignalROI::overlap().
+      bool overlaps(int start, int end) const {
+        for (auto it = first_start(start - m_max_length); it != m_ranges.end() && it->start < end; ++it) {
+          if (std::max(start, it->start) < std::min(end, it->end)) {
+            return true;
+          }
+        }
+        return false;
+      }
+
+      // Append to hits the index of each range overlapping [start, end]
+      // as in overlaps(), in increasing order of index so that callers
+      // see the same order as a loop over the wire's list.
+      void overlapping(int start, int end, std::vector<int>& hits) const {
+        const size_t nhits = hits.size();
+        for (auto it = first_start(start - m_max_length); it != m_ranges.end() && it->start < end; ++it) {
+          if (std::max(start, it->start) < std::min(end, it->end)) {
+            hits.push_back(it->index);
+          }
+        }
+        std::sort(hits.begin() + nhits, hits.end());
+      }
+
+    private:
+      std::vector<Range>::const_iterator first_start(int smin) const {
+        return std::lower_bound(m_ranges.begin(), m_ranges.end(), smin,
+                                [](const Range& r, int s) { return r.start < s; });
+      }
+
+      std::vector<Range> m_ranges;
+      int m_max_length{0};
+    };
+
+  }
+}
+
+#endif
+
+// Local Variables:
+// mode: c++
+// c-basic-offset: 2
+// End:
@@ -1,4 +1,5 @@
 #include "ROI_refinement.h"
+#include "ROI_index.h"
 #include "PeakFinding.h"
 #include <iostream>
 #include <set>
@@ -6,7 +7,7 @@
 using namespace WireCell;
 using namespace WireCell::SigProc;
 
-ROI_refinement::ROI_refinement(Waveform::ChannelMaskMap& cmm,int nwire_u, int nwire_v, int nwire_w, float th_factor, float fake_signal_low_th, float fake_signal_high_th, float fake_signal_low_th_ind_factor, float fake_signal_high_th_ind_factor, int pad, int break_roi_loop, float th_peak, float sep_peak, float low_peak_sep_threshold_pre, int max_npeaks, float sigma, float th_percent)
+ROI_refinement::ROI_refinement(const Waveform::ChannelMaskMap& cmm,int nwire_u, int nwire_v, int nwire_w, float th_factor, float fake_signal_low_th, float fake_signal_high_th, float fake_signal_low_th_ind_factor, float fake_signal_high_th_ind_factor, int pad, int break_roi_loop, float th_peak, float sep_peak, float low_peak_sep_threshold_pre, int max_npeaks, float sigma, float th_percent)
   : nwire_u(nwire_u)
   , nwire_v(nwire_v)
   , nwire_w(nwire_w)
@@ -54,13 +55,16 @@ ROI_refinement::ROI_refinement(Waveform::ChannelMaskMap& cmm,int nwire_u, int nw
     rois_v_loose.at(i) = temp_rois;
   }
 
-  for (auto it = cmm["bad"].begin(); it!=cmm["bad"].end(); it++){
-    int ch = it->first;
-    std::vector<std::pair<int,int>> temps;
-    bad_ch_map[ch] = temps;
-    for (size_t ind = 0; ind < it->second.size(); ind++){
-      bad_ch_map[ch].push_back(std::make_pair(it->second.at(ind).first, it->second.at(ind).second));
-      //std::cout << ch << " " <<  << std::endl;
+  auto badit = cmm.find("bad");
+  if (badit != cmm.end()) {
+    for (auto it = badit->second.begin(); it!=badit->second.end(); it++){
+      int ch = it->first;
+      std::vector<std::pair<int,int>> temps;
+      bad_ch_map[ch] = temps;
+      for (size_t ind = 0; ind < it->second.size(); ind++){
+        bad_ch_map[ch].push_back(std::make_pair(it->second.at(ind).first, it->second.at(ind).second));
+        //std::cout << ch << " " <<  << std::endl;
+      }
     }
   }
   
@@ -72,33 +76,19 @@ ROI_refinement::~ROI_refinement(){
 
 void ROI_refinement::Clear(){
   for (int i=0;i!=nwire_u;i++){
-    for (auto it = rois_u_tight.at(i).begin(); it!=rois_u_tight.at(i).end();it++){
-      delete *it;
-    }
     rois_u_tight.at(i).clear();
-    for (auto it = rois_u_loose.at(i).begin(); it!=rois_u_loose.at(i).end();it++){
-      delete *it;
-    }
     rois_u_loose.at(i).clear();
   }
 
   for (int i=0;i!=nwire_v;i++){
-    for (auto it = rois_v_tight.at(i).begin(); it!=rois_v_tight.at(i).end();it++){
-      delete *it;
-    }
     rois_v_tight.at(i).clear();
-    for (auto it = rois_v_loose.at(i).begin(); it!=rois_v_loose.at(i).end();it++){
-      delete *it;
-    }
     rois_v_loose.at(i).clear();
   }
   
   for (int i=0;i!=nwire_w;i++){
-    for (auto it = rois_w_tight.at(i).begin(); it!=rois_w_tight.at(i).end();it++){
-      delete *it;
-    }
     rois_w_tight.at(i).clear();
   }
+  pool.clear();
   
   front_rois.clear();
   back_rois.clear();
@@ -199,13 +189,13 @@ void ROI_refinement::apply_roi(int plane, Array::array_xxf& r_data){
 
 
 void ROI_refinement::unlink(SignalROI* prev_roi, SignalROI* next_roi){
-  if (front_rois.find(prev_roi)!=front_rois.end()){
+  if (front_rois.has(prev_roi)){
     SignalROISelection& temp_rois = front_rois[prev_roi];
     auto it = find(temp_rois.begin(),temp_rois.end(),next_roi);
     if (it != temp_rois.end())
       temp_rois.erase(it);
   }
-  if (back_rois.find(next_roi)!=back_rois.end()){
+  if (back_rois.has(next_roi)){
     SignalROISelection& temp_rois = back_rois[next_roi];
     auto it = find(temp_rois.begin(),temp_rois.end(),prev_roi);
     if (it != temp_rois.end())
@@ -214,7 +204,7 @@ void ROI_refinement::unlink(SignalROI* prev_roi, SignalROI* next_roi){
 }
 
 void ROI_refinement::link(SignalROI* prev_roi, SignalROI* next_roi){
-  if (front_rois.find(prev_roi)!=front_rois.end()){
+  if (front_rois.has(prev_roi)){
     SignalROISelection& temp_rois = front_rois[prev_roi];
     auto it = find(temp_rois.begin(),temp_rois.end(),next_roi);
     if (it == temp_rois.end())
@@ -225,7 +215,7 @@ void ROI_refinement::link(SignalROI* prev_roi, SignalROI* next_roi){
     front_rois[prev_roi] = temp_rois;
   }
 
-  if (back_rois.find(next_roi)!=back_rois.end()){
+  if (back_rois.has(next_roi)){
     SignalROISelection& temp_rois = back_rois[next_roi];
     auto it = find(temp_rois.begin(),temp_rois.end(),prev_roi);
     if (it == temp_rois.end())
@@ -237,6 +227,29 @@ void ROI_refinement::link(SignalROI* prev_roi, SignalROI* next_roi){
   }
 }
 
+// Call func(roi, other) for each pair of overlapping ROIs, going
+// through rois and then others in order as nested loops would, but
+// only comparing ROIs near each other in time.
+template<typename Func>
+static void for_overlaps(const SignalROISelection& rois, const SignalROIList& other_rois, Func func)
+{
+  if (rois.empty() || other_rois.empty()) {
+    return;
+  }
+  ROI_index index;
+  for (size_t ind=0; ind!=other_rois.size(); ind++){
+    index.insert(other_rois[ind]->get_start_bin(), other_rois[ind]->get_end_bin(), ind);
+  }
+  std::vector<int> hits;
+  for (SignalROI *roi : rois){
+    hits.clear();
+    index.overlapping(roi->get_start_bin(), roi->get_end_bin(), hits);
+    for (int ind : hits){
+      func(roi, other_rois[ind]);
+    }
+  }
+}
+
 void ROI_refinement::load_data(int plane, const Array::array_xxf& r_data, ROI_formation& roi_form){
   // fill RMS 
   std::vector<float> plane_rms;
@@ -251,6 +264,18 @@ void ROI_refinement::load_data(int plane, const Array::array_xxf& r_data, ROI_fo
     offset = nwire_u+nwire_v;
     plane_rms = roi_form.get_wplane_rms();
   }
+  SignalROIChList *tight_rois = &rois_u_tight, *loose_rois = &rois_u_loose;
+  int nwire = nwire_u;
+  if (plane==1){
+    tight_rois = &rois_v_tight;
+    loose_rois = &rois_v_loose;
+    nwire = nwire_v;
+  }else if (plane==2){
+    tight_rois = &rois_w_tight;
+    loose_rois = 0;
+    nwire = nwire_w;
+  }
+  SignalROISelection new_rois;
 
   // load data ... 
   for (int irow = 0; irow!=r_data.rows(); irow++){
@@ -278,304 +303,62 @@ void ROI_refinement::load_data(int plane, const Array::array_xxf& r_data, ROI_fo
     }
 
     int chid = irow+offset;
+    float threshold = plane_rms.at(irow) * th_factor;
     // load tight rois
     std::vector<std::pair<int,int>>& uboone_rois = roi_form.get_self_rois(irow+offset);
+    new_rois.clear();
     for (size_t i=0;i!=uboone_rois.size();i++){
-      SignalROI *tight_roi = new SignalROI(plane,irow+offset, uboone_rois.at(i).first,uboone_rois.at(i).second, signal);
-      float threshold = plane_rms.at(irow) * th_factor;
+      SignalROI *tight_roi = pool.make(plane,irow+offset, uboone_rois.at(i).first,uboone_rois.at(i).second, signal);
       if (tight_roi->get_above_threshold(threshold).size()==0) {
-	delete tight_roi;
+	pool.release(tight_roi);
 	continue;
       }
-      
-      if (plane==0){
-	rois_u_tight[chid].push_back(tight_roi);
-       	if (chid>0){
-       	  //form connectivity map
-       	  for (auto it = rois_u_tight[chid-1].begin();it!=rois_u_tight[chid-1].end();it++){
-       	    SignalROI *prev_roi = *it;
-      	    if (tight_roi->overlap(prev_roi)){
-      	      if (front_rois.find(prev_roi) == front_rois.end()){
-      		SignalROISelection temp_rois;
-      		temp_rois.push_back(tight_roi);
-      		front_rois[prev_roi] = temp_rois;
-      	      }else{
-      		front_rois[prev_roi].push_back(tight_roi);
-      	      }
-      	      if (back_rois.find(tight_roi) == back_rois.end()){
-      		SignalROISelection temp_rois;
-      		temp_rois.push_back(prev_roi);
-      		back_rois[tight_roi] = temp_rois;
-      	      }else{
-      		back_rois[tight_roi].push_back(prev_roi);
-      	      }
-      	    }
-       	  }
-     	}
-	if (chid < nwire_u-1){
-	  // add the code for the next one to be completed
-	  for (auto it = rois_u_tight[chid+1].begin();it!=rois_u_tight[chid+1].end();it++){
-	    SignalROI *next_roi = *it;
-	    if (tight_roi->overlap(next_roi)){
-	      if (back_rois.find(next_roi) == back_rois.end()){
-		SignalROISelection temp_rois;
-		temp_rois.push_back(tight_roi);
-		back_rois[next_roi] = temp_rois;
-	      }else{
-		back_rois[next_roi].push_back(tight_roi);
-	      }
-	      
-	      if (front_rois.find(tight_roi) == front_rois.end()){
-		SignalROISelection temp_rois;
-		temp_rois.push_back(next_roi);
-		front_rois[tight_roi] = temp_rois;
-	      }else{
-		front_rois[tight_roi].push_back(next_roi);
-	      }
-	    }
-	  }
-	}
-      }else if (plane==1){
-	rois_v_tight[chid-nwire_u].push_back(tight_roi);
-      	if (chid>nwire_u){
-      	  //form connectivity map
-      	  for (auto it = rois_v_tight[chid - nwire_u-1].begin();it!=rois_v_tight[chid-nwire_u-1].end();it++){
-      	    SignalROI *prev_roi = *it;
-      	    if (tight_roi->overlap(prev_roi)){
-      	      if (front_rois.find(prev_roi) == front_rois.end()){
-      		SignalROISelection temp_rois;
-      		temp_rois.push_back(tight_roi);
-      		front_rois[prev_roi] = temp_rois;
-      	      }else{
-      		front_rois[prev_roi].push_back(tight_roi);
-      	      }
-      	      if (back_rois.find(tight_roi) == back_rois.end()){
-      		SignalROISelection temp_rois;
-      		temp_rois.push_back(prev_roi);
-      		back_rois[tight_roi] = temp_rois;
-      	      }else{
-      		back_rois[tight_roi].push_back(prev_roi);
-      	      }
-      	    }
-      	  }
-      	}
-	
-	if (chid<nwire_u+nwire_v-1){
-      	  //form connectivity map
-      	  for (auto it = rois_v_tight[chid - nwire_u+1].begin();it!=rois_v_tight[chid-nwire_u+1].end();it++){
-      	    SignalROI *next_roi = *it;
-      	    if (tight_roi->overlap(next_roi)){
-      	      if (back_rois.find(next_roi) == back_rois.end()){
-      		SignalROISelection temp_rois;
-      		temp_rois.push_back(tight_roi);
-      		back_rois[next_roi] = temp_rois;
-      	      }else{
-      		back_rois[next_roi].push_back(tight_roi);
-      	      }
-      	      if (front_rois.find(tight_roi) == front_rois.end()){
-      		SignalROISelection temp_rois;
-      		temp_rois.push_back(next_roi);
-      		front_rois[tight_roi] = temp_rois;
-      	      }else{
-      		front_rois[tight_roi].push_back(next_roi);
-      	      }
-      	    }
-      	  }
-      	}
-      }else {
-	rois_w_tight[chid-nwire_u-nwire_v].push_back(tight_roi);
-	
-      	if (chid>nwire_u+nwire_v){
-      	  //form connectivity map
-      	  for (auto it = rois_w_tight[chid-nwire_u-nwire_v-1].begin();it!=rois_w_tight[chid-nwire_u-nwire_v-1].end();it++){
-      	    SignalROI *prev_roi = *it;
-      	    if (tight_roi->overlap(prev_roi)){
-      	      if (front_rois.find(prev_roi) == front_rois.end()){
-      		SignalROISelection temp_rois;
-      		temp_rois.push_back(tight_roi);
-      		front_rois[prev_roi] = temp_rois;
-      	      }else{
-      		front_rois[prev_roi].push_back(tight_roi);
-      	      }
-      	      if (back_rois.find(tight_roi) == back_rois.end()){
-      		SignalROISelection temp_rois;
-      		temp_rois.push_back(prev_roi);
-      		back_rois[tight_roi] = temp_rois;
-      	      }else{
-      		back_rois[tight_roi].push_back(prev_roi);
-      	      }
-      	    }
-      	  }
-      	}
-
-
-	if (chid<nwire_u+nwire_v+nwire_w-1){
-      	  //form connectivity map
-      	  for (auto it = rois_w_tight[chid-nwire_u-nwire_v+1].begin();it!=rois_w_tight[chid-nwire_u-nwire_v+1].end();it++){
-      	    SignalROI *next_roi = *it;
-      	    if (tight_roi->overlap(next_roi)){
-      	      if (back_rois.find(next_roi) == back_rois.end()){
-      		SignalROISelection temp_rois;
-      		temp_rois.push_back(tight_roi);
-      		back_rois[next_roi] = temp_rois;
-      	      }else{
-      		back_rois[next_roi].push_back(tight_roi);
-      	      }
-      	      if (front_rois.find(tight_roi) == front_rois.end()){
-      		SignalROISelection temp_rois;
-      		temp_rois.push_back(next_roi);
-      		front_rois[tight_roi] = temp_rois;
-      	      }else{
-      		front_rois[tight_roi].push_back(next_roi);
-      	      }
-      	    }
-      	  }
-      	}
-      }
-
-      
-      
-    }// loop over tight rois ... 
+      tight_rois->at(irow).push_back(tight_roi);
+      new_rois.push_back(tight_roi);
+    }
+    //form connectivity map
+    if (irow>0){
+      for_overlaps(new_rois, tight_rois->at(irow-1), [&](SignalROI *roi, SignalROI *prev_roi){
+	  front_rois[prev_roi].push_back(roi);
+	  back_rois[roi].push_back(prev_roi);
+	});
+    }
+    if (irow<nwire-1){
+      for_overlaps(new_rois, tight_rois->at(irow+1), [&](SignalROI *roi, SignalROI *next_roi){
+	  back_rois[next_roi].push_back(roi);
+	  front_rois[roi].push_back(next_roi);
+	});
+    }
 
     if (plane!=2){
       uboone_rois = roi_form.get_loose_rois(chid);
+      new_rois.clear();
       for (size_t i = 0; i!=uboone_rois.size();i++){
-	SignalROI *loose_roi = new SignalROI(plane,chid,uboone_rois.at(i).first,uboone_rois.at(i).second,signal);
-	float threshold = plane_rms.at(irow) * th_factor;
+	SignalROI *loose_roi = pool.make(plane,chid,uboone_rois.at(i).first,uboone_rois.at(i).second,signal);
 	if (loose_roi->get_above_threshold(threshold).size()==0) {
-	  delete loose_roi;
+	  pool.release(loose_roi);
 	  continue;
 	}
-	if (plane==0){
-	  rois_u_loose[chid].push_back(loose_roi);
-	  
-	  if (chid>0){
-	    //form connectivity map
-	    for (auto it=rois_u_loose[chid-1].begin();it!=rois_u_loose[chid-1].end();it++){
-	      SignalROI *prev_roi = *it;
-	      if (loose_roi->overlap(prev_roi)){
-		if (front_rois.find(prev_roi) == front_rois.end()){
-		  SignalROISelection temp_rois;
-		  temp_rois.push_back(loose_roi);
-		  front_rois[prev_roi] = temp_rois;
-		}else{
-		  front_rois[prev_roi].push_back(loose_roi);
-		}
-		if (back_rois.find(loose_roi) == back_rois.end()){
-		  SignalROISelection temp_rois;
-		  temp_rois.push_back(prev_roi);
-		  back_rois[loose_roi] = temp_rois;
-		}else{
-		  back_rois[loose_roi].push_back(prev_roi);
-		}
-	      }
-	    }
-	  }
-	  
-	  if (chid<nwire_u-1){
-	    //form connectivity map
-	    for (auto it=rois_u_loose[chid+1].begin();it!=rois_u_loose[chid+1].end();it++){
-	      SignalROI *next_roi = *it;
-	      if (loose_roi->overlap(next_roi)){
-		if (back_rois.find(next_roi) == back_rois.end()){
-		  SignalROISelection temp_rois;
-		  temp_rois.push_back(loose_roi);
-		  back_rois[next_roi] = temp_rois;
-		}else{
-		  back_rois[next_roi].push_back(loose_roi);
-		}
-		if (front_rois.find(loose_roi) == front_rois.end()){
-		  SignalROISelection temp_rois;
-		  temp_rois.push_back(next_roi);
-		  front_rois[loose_roi] = temp_rois;
-		}else{
-		  front_rois[loose_roi].push_back(next_roi);
-		}
-	      }
-	    }
-	  }
-	  
-	  //form contained map ... 
-	  for (auto it=rois_u_tight[chid].begin();it!=rois_u_tight[chid].end();it++){
-	    SignalROI *tight_roi = *it;
-	    if (tight_roi->overlap(loose_roi)){
-	      if (contained_rois.find(loose_roi)==contained_rois.end()){
-		SignalROISelection temp_rois;
-		temp_rois.push_back(tight_roi);
-		contained_rois[loose_roi] = temp_rois;
-	      }else{
-		contained_rois[loose_roi].push_back(tight_roi);
-	      }
-	      // if (tight_roi->get_start_bin() < loose_roi->get_start_bin())
-	      // 	std::cout << tight_roi->get_start_bin() << " " << loose_roi->get_start_bin() << " " << tight_roi->get_chid() << " " << tight_roi->get_plane() << std::endl;
-	    }
-
-
-	  }
-	}else if (plane==1){
-	  rois_v_loose[chid-nwire_u].push_back(loose_roi);
-	  
-	  if (chid>nwire_u){
-	    //form connectivity map
-	    for (auto it = rois_v_loose[chid-nwire_u-1].begin();it!=rois_v_loose[chid-nwire_u-1].end();it++){
-	      SignalROI *prev_roi = *it;
-	      if (loose_roi->overlap(prev_roi)){
-		if (front_rois.find(prev_roi) == front_rois.end()){
-		  SignalROISelection temp_rois;
-		  temp_rois.push_back(loose_roi);
-		  front_rois[prev_roi] = temp_rois;
-		}else{
-		  front_rois[prev_roi].push_back(loose_roi);
-		}
-		if (back_rois.find(loose_roi) == back_rois.end()){
-		  SignalROISelection temp_rois;
-		  temp_rois.push_back(prev_roi);
-		  back_rois[loose_roi] = temp_rois;
-		}else{
-		  back_rois[loose_roi].push_back(prev_roi);
-		}
-	      }
-	    }
-	  }
-	  
-	  if (chid<nwire_u+nwire_v-1){
-	    //form connectivity map
-	    for (auto it = rois_v_loose[chid-nwire_u+1].begin();it!=rois_v_loose[chid-nwire_u+1].end();it++){
-	      SignalROI *next_roi = *it;
-	      if (loose_roi->overlap(next_roi)){
-		if (back_rois.find(next_roi) == back_rois.end()){
-		  SignalROISelection temp_rois;
-		  temp_rois.push_back(loose_roi);
-		  back_rois[next_roi] = temp_rois;
-		}else{
-		  back_rois[next_roi].push_back(loose_roi);
-		}
-		if (front_rois.find(loose_roi) == front_rois.end()){
-		  SignalROISelection temp_rois;
-		  temp_rois.push_back(next_roi);
-		  front_rois[loose_roi] = temp_rois;
-		}else{
-		  front_rois[loose_roi].push_back(next_roi);
-		}
-	      }
-	    }
-	  }
-	  
-	  //form contained map ... 
-	  for (auto it = rois_v_tight[chid-nwire_u].begin();it!=rois_v_tight[chid-nwire_u].end();it++){
-	    SignalROI *tight_roi = *it;
-	    if (tight_roi->overlap(loose_roi)){
-	      if (contained_rois.find(loose_roi)==contained_rois.end()){
-		SignalROISelection temp_rois;
-		temp_rois.push_back(tight_roi);
-		contained_rois[loose_roi] = temp_rois;
-	      }else{
-		contained_rois[loose_roi].push_back(tight_roi);
-	      }
-	    }
-	  }
-	}
-      }
+	loose_rois->at(irow).push_back(loose_roi);
+	new_rois.push_back(loose_roi);
+      }
+      //form connectivity map
+      if (irow>0){
+	for_overlaps(new_rois, loose_rois->at(irow-1), [&](SignalROI *roi, SignalROI *prev_roi){
+	    front_rois[prev_roi].push_back(roi);
+	    back_rois[roi].push_back(prev_roi);
+	  });
+      }
+      if (irow<nwire-1){
+	for_overlaps(new_rois, loose_rois->at(irow+1), [&](SignalROI *roi, SignalROI *next_roi){
+	    back_rois[next_roi].push_back(roi);
+	    front_rois[roi].push_back(next_roi);
+	  });
+      }
+      //form contained map ... 
+      for_overlaps(new_rois, tight_rois->at(irow), [&](SignalROI *loose_roi, SignalROI *tight_roi){
+	  contained_rois[loose_roi].push_back(tight_roi);
+	});
     }
     
   } // loop over signal rows
@@ -594,7 +377,7 @@ void ROI_refinement::CleanUpROIs(int plane){
       for (auto it = rois_u_loose.at(i).begin(); it!= rois_u_loose.at(i).end();it++){
 	SignalROI *roi = *it;
 	if (ROIsaved_map.find(roi)==ROIsaved_map.end()){
-	  if (contained_rois.find(roi) != contained_rois.end()){
+	  if (contained_rois.has(roi)){
 	    // contain good stuff
 	    SignalROISelection temp_rois;
 	    temp_rois.push_back(roi);
@@ -604,7 +387,7 @@ void ROI_refinement::CleanUpROIs(int plane){
 	      SignalROI *temp_roi = temp_rois.back();
 	      temp_rois.pop_back();
 	      // save all its neighbour into a temporary holder
-	      if (front_rois.find(temp_roi)!=front_rois.end()){
+	      if (front_rois.has(temp_roi)){
 		for (auto it1 = front_rois[temp_roi].begin();it1!=front_rois[temp_roi].end();it1++){
 		  if (ROIsaved_map.find(*it1)==ROIsaved_map.end()){
 		    temp_rois.push_back(*it1);
@@ -612,7 +395,7 @@ void ROI_refinement::CleanUpROIs(int plane){
 		  }
 		}
 	      }
-	      if (back_rois.find(temp_roi)!=back_rois.end()){
+	      if (back_rois.has(temp_roi)){
 		for (auto it1 = back_rois[temp_roi].begin();it1!=back_rois[temp_roi].end();it1++){
 		  if (ROIsaved_map.find(*it1)==ROIsaved_map.end()){
 		    temp_rois.push_back(*it1);
@@ -637,11 +420,11 @@ void ROI_refinement::CleanUpROIs(int plane){
 	  to_be_removed.push_back(roi);
 	  //it = rois_u_loose.at(i).erase(it);
 	  // check contained map
-	  if (contained_rois.find(roi)!= contained_rois.end()){
+	  if (contained_rois.has(roi)){
 	    std::cout << "Wrong! " << std::endl;
 	  }
 	  // check front map
-	  if (front_rois.find(roi)!=front_rois.end()){
+	  if (front_rois.has(roi)){
 	    for (auto it1 = front_rois[roi].begin(); it1 != front_rois[roi].end(); it1++){
 	      auto it2 = find(back_rois[*it1].begin(),back_rois[*it1].end(),roi);
 	      back_rois[*it1].erase(it2);
@@ -649,7 +432,7 @@ void ROI_refinement::CleanUpROIs(int plane){
 	    front_rois.erase(roi);
 	  }
 	  // check back map
-	  if (back_rois.find(roi)!=back_rois.end()){
+	  if (back_rois.has(roi)){
 	    for (auto it1 = back_rois[roi].begin(); it1!=back_rois[roi].end(); it1++){
 	      auto it2 = find(front_rois[*it1].begin(),front_rois[*it1].end(),roi);
 	      front_rois[*it1].erase(it2);
@@ -662,7 +445,7 @@ void ROI_refinement::CleanUpROIs(int plane){
       for (auto it = to_be_removed.begin(); it!= to_be_removed.end(); it++){
 	auto it1 = find(rois_u_loose.at(i).begin(), rois_u_loose.at(i).end(),*it);
 	rois_u_loose.at(i).erase(it1);
-	delete (*it);
+	pool.release(*it);
       }
     }
   }else if (plane==1){
@@ -673,7 +456,7 @@ void ROI_refinement::CleanUpROIs(int plane){
       for (auto it = rois_v_loose.at(i).begin(); it!= rois_v_loose.at(i).end();it++){
 	SignalROI *roi = *it;
 	if (ROIsaved_map.find(roi)==ROIsaved_map.end()){
-	  if (contained_rois.find(roi) != contained_rois.end()){
+	  if (contained_rois.has(roi)){
 	    // contain good stuff
 	    SignalROISelection temp_rois;
 	    temp_rois.push_back(roi);
@@ -683,7 +466,7 @@ void ROI_refinement::CleanUpROIs(int plane){
 	      SignalROI *temp_roi = temp_rois.back();
 	      temp_rois.pop_back();
 	      // save all its neighbour into a temporary holder
-	      if (front_rois.find(temp_roi)!=front_rois.end()){
+	      if (front_rois.has(temp_roi)){
 		for (auto it1 = front_rois[temp_roi].begin();it1!=front_rois[temp_roi].end();it1++){
 		  if (ROIsaved_map.find(*it1)==ROIsaved_map.end()){
 		    temp_rois.push_back(*it1);
@@ -691,7 +474,7 @@ void ROI_refinement::CleanUpROIs(int plane){
 		  }
 		}
 	      }
-	      if (back_rois.find(temp_roi)!=back_rois.end()){
+	      if (back_rois.has(temp_roi)){
 		for (auto it1 = back_rois[temp_roi].begin();it1!=back_rois[temp_roi].end();it1++){
 		  if (ROIsaved_map.find(*it1)==ROIsaved_map.end()){
 		    temp_rois.push_back(*it1);
@@ -716,11 +499,11 @@ void ROI_refinement::CleanUpROIs(int plane){
 	  to_be_removed.push_back(roi);
 	  //it = rois_v_loose.at(i).erase(it);
 	  // check contained map
-	  if (contained_rois.find(roi)!= contained_rois.end()){
+	  if (contained_rois.has(roi)){
 	    std::cout << "Wrong! " << std::endl;
 	  }
 	  // check front map
-	  if (front_rois.find(roi)!=front_rois.end()){
+	  if (front_rois.has(roi)){
 	    for (auto it1 = front_rois[roi].begin(); it1 != front_rois[roi].end(); it1++){
 	      auto it2 = find(back_rois[*it1].begin(),back_rois[*it1].end(),roi);
 	      back_rois[*it1].erase(it2);
@@ -728,7 +511,7 @@ void ROI_refinement::CleanUpROIs(int plane){
 	    front_rois.erase(roi);
 	  }
 	  // check back map
-	  if (back_rois.find(roi)!=back_rois.end()){
+	  if (back_rois.has(roi)){
 	    for (auto it1 = back_rois[roi].begin(); it1!=back_rois[roi].end(); it1++){
 	      auto it2 = find(front_rois[*it1].begin(),front_rois[*it1].end(),roi);
 	      front_rois[*it1].erase(it2);
@@ -741,7 +524,7 @@ void ROI_refinement::CleanUpROIs(int plane){
       for (auto it = to_be_removed.begin(); it!= to_be_removed.end(); it++){
 	auto it1 = find(rois_v_loose.at(i).begin(), rois_v_loose.at(i).end(),*it);
 	rois_v_loose.at(i).erase(it1);
-	delete (*it);
+	pool.release(*it);
       }
     }
   }
@@ -763,7 +546,7 @@ void ROI_refinement::generate_merge_ROIs(int plane){
       std::map<SignalROI*,int> covered_tight_rois;
       for (auto it = rois_u_loose.at(i).begin();it!=rois_u_loose.at(i).end();it++){
 	SignalROI *roi = *it;
-	if (contained_rois.find(roi) != contained_rois.end()){
+	if (contained_rois.has(roi)){
 	  for (auto it1 = contained_rois[roi].begin(); it1!= contained_rois[roi].end(); it1++){
 	    if (covered_tight_rois.find(*it1)==covered_tight_rois.end()){
 	      covered_tight_rois[*it1]  =1;
@@ -784,7 +567,7 @@ void ROI_refinement::generate_merge_ROIs(int plane){
       for (auto it = saved_rois.begin(); it!=saved_rois.end();it++){
 	SignalROI *roi = *it;
 	// Duplicate them 
-	SignalROI *loose_roi = new SignalROI(roi);
+	SignalROI *loose_roi = pool.copy(roi);
 	
 	rois_u_loose.at(i).push_back(loose_roi);
 	
@@ -799,7 +582,7 @@ void ROI_refinement::generate_merge_ROIs(int plane){
 	    SignalROI *next_roi = *it1;
 	    
 	    if (loose_roi->overlap(next_roi)){
-	      if (back_rois.find(next_roi) == back_rois.end()){
+	      if (!back_rois.has(next_roi)){
 		SignalROISelection temp_rois;
 		temp_rois.push_back(loose_roi);
 		back_rois[next_roi] = temp_rois;
@@ -807,7 +590,7 @@ void ROI_refinement::generate_merge_ROIs(int plane){
 		back_rois[next_roi].push_back(loose_roi);
 	      }
 	      
-	      if (front_rois.find(loose_roi) == front_rois.end()){
+	      if (!front_rois.has(loose_roi)){
 		SignalROISelection temp_rois;
 		temp_rois.push_back(next_roi);
 		front_rois[loose_roi] = temp_rois;
@@ -823,14 +606,14 @@ void ROI_refinement::generate_merge_ROIs(int plane){
 	  for (auto it1 = rois_u_loose.at(i-1).begin(); it1!=rois_u_loose.at(i-1).end(); it1++){
 	    SignalROI *prev_roi = *it1;
 	    if (loose_roi->overlap(prev_roi)){
-	      if (front_rois.find(prev_roi) == front_rois.end()){
+	      if (!front_rois.has(prev_roi)){
 		SignalROISelection temp_rois;
 		temp_rois.push_back(loose_roi);
 		front_rois[prev_roi] = temp_rois;
 	      }else{
 		front_rois[prev_roi].push_back(loose_roi);
 	      }
-	      if (back_rois.find(loose_roi) == back_rois.end()){
+	      if (!back_rois.has(loose_roi)){
 		SignalROISelection temp_rois;
 		temp_rois.push_back(prev_roi);
 		back_rois[loose_roi] = temp_rois;
@@ -847,7 +630,7 @@ void ROI_refinement::generate_merge_ROIs(int plane){
       std::map<SignalROI*,int> covered_tight_rois;
       for (auto it = rois_v_loose.at(i).begin();it!=rois_v_loose.at(i).end();it++){
 	SignalROI *roi = *it;
-	if (contained_rois.find(roi) != contained_rois.end()){
+	if (contained_rois.has(roi)){
 	  for (auto it1 = contained_rois[roi].begin(); it1!= contained_rois[roi].end(); it1++){
 	    if (covered_tight_rois.find(*it1)==covered_tight_rois.end()){
 	      covered_tight_rois[*it1]  =1;
@@ -869,7 +652,7 @@ void ROI_refinement::generate_merge_ROIs(int plane){
       for (auto it = saved_rois.begin(); it!=saved_rois.end();it++){
 	SignalROI *roi = *it;
 	// Duplicate them 
-	SignalROI *loose_roi = new SignalROI(roi);
+	SignalROI *loose_roi = pool.copy(roi);
 	
 	rois_v_loose.at(i).push_back(loose_roi);
 	
@@ -884,7 +667,7 @@ void ROI_refinement::generate_merge_ROIs(int plane){
 	    SignalROI *next_roi = *it1;
 	    
 	    if (loose_roi->overlap(next_roi)){
-	      if (back_rois.find(next_roi) == back_rois.end()){
+	      if (!back_rois.has(next_roi)){
 		SignalROISelection temp_rois;
 		temp_rois.push_back(loose_roi);
 		back_rois[next_roi] = temp_rois;
@@ -892,7 +675,7 @@ void ROI_refinement::generate_merge_ROIs(int plane){
 		back_rois[next_roi].push_back(loose_roi);
 	      }
 	      
-	      if (front_rois.find(loose_roi) == front_rois.end()){
+	      if (!front_rois.has(loose_roi)){
 		SignalROISelection temp_rois;
 		temp_rois.push_back(next_roi);
 		front_rois[loose_roi] = temp_rois;
@@ -908,14 +691,14 @@ void ROI_refinement::generate_merge_ROIs(int plane){
 	  for (auto it1 = rois_v_loose.at(i-1).begin(); it1!=rois_v_loose.at(i-1).end(); it1++){
 	    SignalROI *prev_roi = *it1;
 	    if (loose_roi->overlap(prev_roi)){
-	      if (front_rois.find(prev_roi) == front_rois.end()){
+	      if (!front_rois.has(prev_roi)){
 		SignalROISelection temp_rois;
 		temp_rois.push_back(loose_roi);
 		front_rois[prev_roi] = temp_rois;
 	      }else{
 		front_rois[prev_roi].push_back(loose_roi);
 	      }
-	      if (back_rois.find(loose_roi) == back_rois.end()){
+	      if (!back_rois.has(loose_roi)){
 		SignalROISelection temp_rois;
 		temp_rois.push_back(prev_roi);
 		back_rois[loose_roi] = temp_rois;
@@ -942,7 +725,7 @@ void ROI_refinement::CheckROIs(int plane,ROI_formation& roi_form){
     //     if (chid != i) 
     // 	std::cout << roi << std::endl;
     
-    //     if (front_rois.find(roi)!=front_rois.end()){
+    //     if (front_rois.has(roi)){
     //  	for (auto it1 = front_rois[roi].begin();it1!=front_rois[roi].end();it1++){
     // 	  SignalROI *roi1 = *it1;
     // 	  int chid1 = roi1->get_chid();
@@ -961,7 +744,7 @@ void ROI_refinement::CheckROIs(int plane,ROI_formation& roi_form){
 	float th;
 	th = th_factor*rms_u.at(chid);
 	
-	if (front_rois.find(roi)!=front_rois.end()){
+	if (front_rois.has(roi)){
 	  SignalROISelection temp_rois;
 	  for (auto it1 = front_rois[roi].begin();it1!=front_rois[roi].end();it1++){
 	    SignalROI *roi1 = *it1;
@@ -980,7 +763,7 @@ void ROI_refinement::CheckROIs(int plane,ROI_formation& roi_form){
 	  }
 	}
 
-	if (back_rois.find(roi)!=back_rois.end()){
+	if (back_rois.has(roi)){
 	  SignalROISelection temp_rois;
 	  for (auto it1 = back_rois[roi].begin();it1!=back_rois[roi].end();it1++){
 	    SignalROI *roi1 = *it1;
@@ -1010,7 +793,7 @@ void ROI_refinement::CheckROIs(int plane,ROI_formation& roi_form){
 	int chid = roi->get_chid()-nwire_u;
 	float th;
 	th = th_factor*rms_v.at(chid);
-	if (front_rois.find(roi)!=front_rois.end()){
+	if (front_rois.has(roi)){
 	  SignalROISelection temp_rois;
 	  for (auto it1 = front_rois[roi].begin();it1!=front_rois[roi].end();it1++){
 	    SignalROI *roi1 = *it1;
@@ -1028,7 +811,7 @@ void ROI_refinement::CheckROIs(int plane,ROI_formation& roi_form){
 	  }
 	}
 	
-	if (back_rois.find(roi)!=back_rois.end()){
+	if (back_rois.has(roi)){
 	  SignalROISelection temp_rois;
 	  for (auto it1 = back_rois[roi].begin();it1!=back_rois[roi].end();it1++){
 	    SignalROI *roi1 = *it1;
@@ -1064,13 +847,13 @@ void ROI_refinement::CleanUpCollectionROIs(){
     }
   }
   // for a particular ROI if it is not in, or it is not connected with one in the temporary map, then remove it
-  std::list<SignalROI*> Bad_ROIs;
+  SignalROISelection Bad_ROIs;
   for (int i=0;i!=nwire_w;i++){
     for (auto it = rois_w_tight.at(i).begin();it!=rois_w_tight.at(i).end();it++){
       SignalROI* roi = *it;
       
       if (Good_ROIs.find(roi)!=Good_ROIs.end()) continue;
-      if (front_rois.find(roi)!=front_rois.end()){
+      if (front_rois.has(roi)){
 	SignalROISelection next_rois = front_rois[roi];
 	int flag_qx = 0;
 	for (size_t i=0;i!=next_rois.size();i++){
@@ -1083,7 +866,7 @@ void ROI_refinement::CleanUpCollectionROIs(){
 	if (flag_qx == 1) continue;
       }
       
-      if (back_rois.find(roi)!=back_rois.end()){
+      if (back_rois.has(roi)){
 	SignalROISelection next_rois = back_rois[roi];
 	int flag_qx = 0;
 	for (size_t i=0;i!=next_rois.size();i++){
@@ -1106,7 +889,7 @@ void ROI_refinement::CleanUpCollectionROIs(){
     SignalROI* roi = *it;
     int chid = roi->get_chid()-nwire_u-nwire_v;
     //std::cout << chid << std::endl;
-    if (front_rois.find(roi)!=front_rois.end()){
+    if (front_rois.has(roi)){
       SignalROISelection next_rois = front_rois[roi];
       for (size_t i=0;i!=next_rois.size();i++){
    	//unlink the current roi
@@ -1115,7 +898,7 @@ void ROI_refinement::CleanUpCollectionROIs(){
       front_rois.erase(roi);
     }
     
-    if (back_rois.find(roi)!=back_rois.end()){
+    if (back_rois.has(roi)){
       SignalROISelection prev_rois = back_rois[roi];
       for (size_t i=0;i!=prev_rois.size();i++){
    	//unlink the current roi
@@ -1127,7 +910,7 @@ void ROI_refinement::CleanUpCollectionROIs(){
     if (it1 != rois_w_tight.at(chid).end())
       rois_w_tight.at(chid).erase(it1);
     
-    delete roi;
+    pool.release(roi);
   }
   
 }
@@ -1140,12 +923,12 @@ void ROI_refinement::CleanUpInductionROIs(int plane){
   mean_threshold *= fake_signal_low_th_ind_factor;
   threshold *= fake_signal_high_th_ind_factor;
   
-  std::list<SignalROI*> Bad_ROIs;
+  SignalROISelection Bad_ROIs;
   if (plane==0){
     for (int i=0;i!=nwire_u;i++){
       for (auto it = rois_u_loose.at(i).begin();it!=rois_u_loose.at(i).end();it++){
 	SignalROI* roi = *it;
-	if (front_rois.find(roi)==front_rois.end() && back_rois.find(roi)==back_rois.end()){
+	if (!front_rois.has(roi) && !back_rois.has(roi)){
 	  if (roi->get_above_threshold(threshold).size()==0 && roi->get_average_heights() < mean_threshold)
 	    Bad_ROIs.push_back(roi);
 	}
@@ -1158,7 +941,7 @@ void ROI_refinement::CleanUpInductionROIs(int plane){
       if (it1 != rois_u_loose.at(chid).end())
 	rois_u_loose.at(chid).erase(it1);
 
-      if (front_rois.find(roi)!=front_rois.end()){
+      if (front_rois.has(roi)){
 	SignalROISelection next_rois = front_rois[roi];
 	for (size_t i=0;i!=next_rois.size();i++){
 	  //unlink the current roi
@@ -1167,7 +950,7 @@ void ROI_refinement::CleanUpInductionROIs(int plane){
 	front_rois.erase(roi);
       }
       
-      if (back_rois.find(roi)!=back_rois.end()){
+      if (back_rois.has(roi)){
 	SignalROISelection prev_rois = back_rois[roi];
 	for (size_t i=0;i!=prev_rois.size();i++){
 	  //unlink the current roi
@@ -1176,14 +959,14 @@ void ROI_refinement::CleanUpInductionROIs(int plane){
 	back_rois.erase(roi);
       }
       
-      delete roi;
+      pool.release(roi);
     }
     Bad_ROIs.clear();
   }else if (plane==1){
     for (int i=0;i!=nwire_v;i++){
       for (auto it = rois_v_loose.at(i).begin();it!=rois_v_loose.at(i).end();it++){
 	SignalROI* roi = *it;
-	if (front_rois.find(roi)==front_rois.end() && back_rois.find(roi)==back_rois.end()){
+	if (!front_rois.has(roi) && !back_rois.has(roi)){
 	  if (roi->get_above_threshold(threshold).size()==0 && roi->get_average_heights() < mean_threshold)
 	    Bad_ROIs.push_back(roi);
 	}
@@ -1196,7 +979,7 @@ void ROI_refinement::CleanUpInductionROIs(int plane){
       if (it1 != rois_v_loose.at(chid).end())
 	rois_v_loose.at(chid).erase(it1);
 
-      if (front_rois.find(roi)!=front_rois.end()){
+      if (front_rois.has(roi)){
 	SignalROISelection next_rois = front_rois[roi];
 	for (size_t i=0;i!=next_rois.size();i++){
 	  //unlink the current roi
@@ -1205,7 +988,7 @@ void ROI_refinement::CleanUpInductionROIs(int plane){
 	front_rois.erase(roi);
       }
       
-      if (back_rois.find(roi)!=back_rois.end()){
+      if (back_rois.has(roi)){
 	SignalROISelection prev_rois = back_rois[roi];
 	for (size_t i=0;i!=prev_rois.size();i++){
 	  //unlink the current roi
@@ -1215,7 +998,7 @@ void ROI_refinement::CleanUpInductionROIs(int plane){
       }
       
       
-      delete roi;
+      pool.release(roi);
     }
   }
 
@@ -1236,7 +1019,7 @@ void ROI_refinement::CleanUpInductionROIs(int plane){
 	SignalROI* roi = *it;
 	
 	if (Good_ROIs.find(roi)!=Good_ROIs.end()) continue;
-	if (front_rois.find(roi)!=front_rois.end()){
+	if (front_rois.has(roi)){
 	  SignalROISelection next_rois = front_rois[roi];
 	  int flag_qx = 0;
 	  for (size_t i=0;i!=next_rois.size();i++){
@@ -1249,7 +1032,7 @@ void ROI_refinement::CleanUpInductionROIs(int plane){
 	  if (flag_qx == 1) continue;
 	}
 	
-	if (back_rois.find(roi)!=back_rois.end()){
+	if (back_rois.has(roi)){
 	  SignalROISelection next_rois = back_rois[roi];
 	  int flag_qx = 0;
 	  for (size_t i=0;i!=next_rois.size();i++){
@@ -1269,7 +1052,7 @@ void ROI_refinement::CleanUpInductionROIs(int plane){
       SignalROI* roi = *it;
       int chid = roi->get_chid();
       //std::cout << chid << std::endl;
-      if (front_rois.find(roi)!=front_rois.end()){
+      if (front_rois.has(roi)){
 	SignalROISelection next_rois = front_rois[roi];
 	for (size_t i=0;i!=next_rois.size();i++){
 	  //unlink the current roi
@@ -1278,7 +1061,7 @@ void ROI_refinement::CleanUpInductionROIs(int plane){
 	front_rois.erase(roi);
       }
       
-      if (back_rois.find(roi)!=back_rois.end()){
+      if (back_rois.has(roi)){
 	SignalROISelection prev_rois = back_rois[roi];
 	for (size_t i=0;i!=prev_rois.size();i++){
 	  //unlink the current roi
@@ -1290,7 +1073,7 @@ void ROI_refinement::CleanUpInductionROIs(int plane){
       if (it1 != rois_u_loose.at(chid).end())
 	rois_u_loose.at(chid).erase(it1);
       
-      delete roi;
+      pool.release(roi);
     }
   }else if (plane==1){
     
@@ -1308,7 +1091,7 @@ void ROI_refinement::CleanUpInductionROIs(int plane){
 	SignalROI* roi = *it;
 	
 	if (Good_ROIs.find(roi)!=Good_ROIs.end()) continue;
-	if (front_rois.find(roi)!=front_rois.end()){
+	if (front_rois.has(roi)){
 	  SignalROISelection next_rois = front_rois[roi];
 	  int flag_qx = 0;
 	  for (size_t i=0;i!=next_rois.size();i++){
@@ -1321,7 +1104,7 @@ void ROI_refinement::CleanUpInductionROIs(int plane){
 	  if (flag_qx == 1) continue;
 	}
 	
-	if (back_rois.find(roi)!=back_rois.end()){
+	if (back_rois.has(roi)){
 	  SignalROISelection next_rois = back_rois[roi];
 	  int flag_qx = 0;
 	  for (size_t i=0;i!=next_rois.size();i++){
@@ -1341,7 +1124,7 @@ void ROI_refinement::CleanUpInductionROIs(int plane){
       SignalROI* roi = *it;
       int chid = roi->get_chid()-nwire_u;
       //std::cout << chid << std::endl;
-      if (front_rois.find(roi)!=front_rois.end()){
+      if (front_rois.has(roi)){
 	SignalROISelection next_rois = front_rois[roi];
 	for (size_t i=0;i!=next_rois.size();i++){
 	  //unlink the current roi
@@ -1350,7 +1133,7 @@ void ROI_refinement::CleanUpInductionROIs(int plane){
 	front_rois.erase(roi);
       }
       
-      if (back_rois.find(roi)!=back_rois.end()){
+      if (back_rois.has(roi)){
 	SignalROISelection prev_rois = back_rois[roi];
 	for (size_t i=0;i!=prev_rois.size();i++){
 	  //unlink the current roi
@@ -1362,7 +1145,7 @@ void ROI_refinement::CleanUpInductionROIs(int plane){
       if (it1 != rois_v_loose.at(chid).end())
 	rois_v_loose.at(chid).erase(it1);
       
-      delete roi;
+      pool.release(roi);
     }
   }
 }
@@ -1376,7 +1159,7 @@ void ROI_refinement::ShrinkROI(SignalROI *roi, ROI_formation& roi_form){
   
   int chid = roi->get_chid();
   int plane = roi->get_plane();
-  std::vector<float>& contents = roi->get_contents();
+  SignalROIContents& contents = roi->get_contents();
   
   float threshold1=0;
   if (plane==0){
@@ -1394,7 +1177,7 @@ void ROI_refinement::ShrinkROI(SignalROI *roi, ROI_formation& roi_form){
   // TH1F *htemp = new TH1F("htemp","htemp",end_bin-start_bin+1,start_bin,end_bin+1);
   
   // check tight ROIs
-  if (contained_rois.find(roi)!=contained_rois.end()){
+  if (contained_rois.has(roi)){
     for (auto it = contained_rois[roi].begin();it!=contained_rois[roi].end();it++){
       SignalROI *tight_roi = *it;
       int start_bin1 = tight_roi->get_start_bin();
@@ -1415,7 +1198,7 @@ void ROI_refinement::ShrinkROI(SignalROI *roi, ROI_formation& roi_form){
   // std::cout << "check front ROIs " << std::endl;
 
   //check front ROIs
-  if (front_rois.find(roi)!=front_rois.end()){
+  if (front_rois.has(roi)){
     for (auto it=front_rois[roi].begin();it!=front_rois[roi].end();it++){
       SignalROI *next_roi = *it;
       int start_bin1 = next_roi->get_start_bin();
@@ -1446,7 +1229,7 @@ void ROI_refinement::ShrinkROI(SignalROI *roi, ROI_formation& roi_form){
   //std::cout << "check back ROIs " << std::endl;
 
   //check back ROIs
-  if (back_rois.find(roi)!=back_rois.end()){
+  if (back_rois.has(roi)){
     for (auto it=back_rois[roi].begin();it!=back_rois[roi].end();it++){
       SignalROI *prev_roi = *it;
       int start_bin1 = prev_roi->get_start_bin();
@@ -1520,7 +1303,7 @@ void ROI_refinement::ShrinkROI(SignalROI *roi, ROI_formation& roi_form){
   
   SignalROISelection new_rois;
   if (new_start_bin >=0 && new_end_bin > new_start_bin){
-    SignalROI *new_roi = new SignalROI(plane,chid,new_start_bin,new_end_bin,signal);
+    SignalROI *new_roi = pool.make(plane,chid,new_start_bin,new_end_bin,signal);
     new_rois.push_back(new_roi);
   }
 
@@ -1543,7 +1326,7 @@ void ROI_refinement::ShrinkROI(SignalROI *roi, ROI_formation& roi_form){
   
   // update all the maps 
   // update front map
-  if (front_rois.find(roi)!=front_rois.end()){
+  if (front_rois.has(roi)){
     SignalROISelection next_rois = front_rois[roi];
     for (size_t i=0;i!=next_rois.size();i++){
       //unlink the current roi
@@ -1557,7 +1340,7 @@ void ROI_refinement::ShrinkROI(SignalROI *roi, ROI_formation& roi_form){
     front_rois.erase(roi);
   }
   // update back map
-  if (back_rois.find(roi)!=back_rois.end()){
+  if (back_rois.has(roi)){
     SignalROISelection prev_rois = back_rois[roi];
     for (size_t i=0;i!=prev_rois.size();i++){
       // unlink the current roi
@@ -1572,12 +1355,12 @@ void ROI_refinement::ShrinkROI(SignalROI *roi, ROI_formation& roi_form){
   }
   
   // update contained map 
-  if (contained_rois.find(roi)!=contained_rois.end()){
+  if (contained_rois.has(roi)){
     SignalROISelection tight_rois = contained_rois[roi];
     for (size_t i=0;i!=tight_rois.size();i++){
       for (size_t j=0;j!=new_rois.size();j++){
 	if (new_rois.at(j)->overlap(tight_rois.at(i))){
-	  if (contained_rois.find(new_rois.at(j)) == contained_rois.end()){
+	  if (!contained_rois.has(new_rois.at(j))){
 	    SignalROISelection temp_rois;
 	    temp_rois.push_back(tight_rois.at(i));
 	    contained_rois[new_rois.at(j)] = temp_rois;
@@ -1590,8 +1373,8 @@ void ROI_refinement::ShrinkROI(SignalROI *roi, ROI_formation& roi_form){
     contained_rois.erase(roi);
   }
   
-  // delete the old ROI
-  delete roi;
+  // release the old ROI
+  pool.release(roi);
 
   // delete htemp;
   // delete h1;
@@ -1634,7 +1417,7 @@ void ROI_refinement::BreakROI(SignalROI *roi, float rms){
 
   Waveform::realseq_t temp_signal(end_bin-start_bin+1,0);
   // TH1F *htemp = new TH1F("htemp","htemp",end_bin-start_bin+1,start_bin,end_bin+1);
-  std::vector<float>& contents = roi->get_contents();
+  SignalROIContents& contents = roi->get_contents();
   for (size_t i=0;i!=temp_signal.size();i++){
     temp_signal.at(i) = contents.at(i);
     //    htemp->SetBinContent(i+1,contents.at(i));
@@ -1994,7 +1777,7 @@ void ROI_refinement::BreakROI1(SignalROI *roi){
 
   Waveform::realseq_t temp_signal(end_bin-start_bin+1,0);
   // TH1F *htemp = new TH1F("htemp","htemp",end_bin-start_bin+1,start_bin,end_bin+1);
-  std::vector<float>& contents = roi->get_contents();
+  SignalROIContents& contents = roi->get_contents();
   for (size_t i=0;i!=temp_signal.size();i++){
     temp_signal.at(i) = contents.at(i);
     //   htemp->SetBinContent(i+1,contents.at(i));
@@ -2028,7 +1811,7 @@ void ROI_refinement::BreakROI1(SignalROI *roi){
       //      h1->SetBinContent(j+1,htemp->GetBinContent(j-start_bin+1));
     }
     if (start_bin1 >=0 && end_bin1 >start_bin1){
-      SignalROI *sub_roi = new SignalROI(plane,chid,start_bin1,end_bin1,signal);
+      SignalROI *sub_roi = pool.make(plane,chid,start_bin1,end_bin1,signal);
       new_rois.push_back(sub_roi);
     }
   }
@@ -2050,7 +1833,7 @@ void ROI_refinement::BreakROI1(SignalROI *roi){
   
   // update all the maps 
   // update front map
-  if (front_rois.find(roi)!=front_rois.end()){
+  if (front_rois.has(roi)){
     SignalROISelection next_rois = front_rois[roi];
     for (size_t i=0;i!=next_rois.size();i++){
       //unlink the current roi
@@ -2064,7 +1847,7 @@ void ROI_refinement::BreakROI1(SignalROI *roi){
     front_rois.erase(roi);
   }
   // update back map
-  if (back_rois.find(roi)!=back_rois.end()){
+  if (back_rois.has(roi)){
     SignalROISelection prev_rois = back_rois[roi];
     for (size_t i=0;i!=prev_rois.size();i++){
       // unlink the current roi
@@ -2079,12 +1862,12 @@ void ROI_refinement::BreakROI1(SignalROI *roi){
   }
   
   // update contained map 
-  if (contained_rois.find(roi)!=contained_rois.end()){
+  if (contained_rois.has(roi)){
     SignalROISelection tight_rois = contained_rois[roi];
     for (size_t i=0;i!=tight_rois.size();i++){
       for (size_t j=0;j!=new_rois.size();j++){
 	if (new_rois.at(j)->overlap(tight_rois.at(i))){
-	  if (contained_rois.find(new_rois.at(j)) == contained_rois.end()){
+	  if (!contained_rois.has(new_rois.at(j))){
 	    SignalROISelection temp_rois;
 	    temp_rois.push_back(tight_rois.at(i));
 	    contained_rois[new_rois.at(j)] = temp_rois;
@@ -2097,8 +1880,8 @@ void ROI_refinement::BreakROI1(SignalROI *roi){
     contained_rois.erase(roi);
   }
   
-  // delete the old ROI
-  delete roi;
+  // release the old ROI
+  pool.release(roi);
   //  delete h1;
   //  delete htemp;
 }
@@ -2253,7 +2036,7 @@ void ROI_refinement::ExtendROIs(){
   
   // U plane ... 
   for (int chid = 0; chid != nwire_u; chid ++){
-    rois_u_loose.at(chid).sort(CompareRois());
+    std::stable_sort(rois_u_loose.at(chid).begin(), rois_u_loose.at(chid).end(), CompareRois());
     for (auto it = rois_u_loose.at(chid).begin(); it!= rois_u_loose.at(chid).end();it++){
       SignalROI *roi =  *it;
       // initialize the extended bins ... 
@@ -2308,7 +2091,7 @@ void ROI_refinement::ExtendROIs(){
   }
   // V plane
   for (int chid = 0; chid != nwire_v; chid ++){
-    rois_v_loose.at(chid).sort(CompareRois());
+    std::stable_sort(rois_v_loose.at(chid).begin(), rois_v_loose.at(chid).end(), CompareRois());
     for (auto it = rois_v_loose.at(chid).begin(); it!= rois_v_loose.at(chid).end();it++){
       SignalROI *roi =  *it;
       // initialize the extended bins ... 
@@ -2364,7 +2147,7 @@ void ROI_refinement::ExtendROIs(){
 
   // W plane
   for (int chid = 0; chid != nwire_w; chid ++){
-    rois_w_tight.at(chid).sort(CompareRois());
+    std::stable_sort(rois_w_tight.at(chid).begin(), rois_w_tight.at(chid).end(), CompareRois());
     for (auto it = rois_w_tight.at(chid).begin(); it!= rois_w_tight.at(chid).end();it++){
       SignalROI *roi =  *it;
       // initialize the extended bins ... 
@@ -16,7 +16,7 @@ namespace WireCell{
     
     class ROI_refinement{
     public:
-      ROI_refinement(Waveform::ChannelMaskMap& cmm,int nwire_u, int nwire_v, int nwire_w, float th_factor = 3.0, float fake_signal_low_th = 500, float fake_signal_high_th = 1000, float fake_signal_low_th_ind_factor=1.0, float fake_signal_high_th_ind_factor=1.0, int pad = 5, int break_roi_loop = 2, float th_peak = 3.0, float sep_peak = 6.0, float low_peak_sep_threshold_pre = 1200, int max_npeaks = 200, float sigma = 2, float th_percent = 0.1); 
+      ROI_refinement(const Waveform::ChannelMaskMap& cmm,int nwire_u, int nwire_v, int nwire_w, float th_factor = 3.0, float fake_signal_low_th = 500, float fake_signal_high_th = 1000, float fake_signal_low_th_ind_factor=1.0, float fake_signal_high_th_ind_factor=1.0, int pad = 5, int break_roi_loop = 2, float th_peak = 3.0, float sep_peak = 6.0, float low_peak_sep_threshold_pre = 1200, int max_npeaks = 200, float sigma = 2, float th_percent = 0.1); 
       ~ROI_refinement();
 
       void Clear();
@@ -72,6 +72,9 @@ namespace WireCell{
       void TestROIs();
       
       std::map<int,std::vector<std::pair<int,int>>> bad_ch_map;
+
+      // holds all the ROIs below
+      SignalROIPool pool;
       
       
       SignalROIChList rois_u_tight;
@@ -82,9 +85,9 @@ namespace WireCell{
       SignalROIChList rois_v_loose;
    
     
-      SignalROIMap front_rois;
-      SignalROIMap back_rois;
-      SignalROIMap contained_rois;
+      SignalROILinks front_rois;
+      SignalROILinks back_rois;
+      SignalROILinks contained_rois;
       
     };
   }
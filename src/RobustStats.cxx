@@ -0,0 +1,85 @@
+#include "WireCellSigProc/RobustStats.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace WireCell::SigProc;
+
+void RobustStats::percentiles(const float* data, int n, const float* fracs, float* out, int nfracs)
+{
+  if (n <= 0) {
+    std::fill(out, out + nfracs, 0.0f);
+    return;
+  }
+
+  // min and max in one branch free pass
+  float vmin = data[0], vmax = data[0];
+  for (int ind = 1; ind < n; ++ind) {
+    const float val = data[ind];
+    vmin = val < vmin ? val : vmin;
+    vmax = val > vmax ? val : vmax;
+  }
+  const int nbins = n;
+  const float binsize = (vmax - vmin) / nbins;
+
+  // The bin indices are computed in a separate loop from the
+  // histogram filling so the former can be vectorized.  All samples
+  // the same land in the first bin.
+  m_bins.resize(n);
+  int* bins = m_bins.data();
+  if (binsize > 0) {
+    for (int ind = 0; ind < n; ++ind) {
+      const int bin = int(std::round((data[ind] - vmin) / binsize));
+      bins[ind] = std::min(nbins - 1, std::max(0, bin));
+    }
+  }
+  else {
+    std::fill(bins, bins + n, 0);
+  }
+  m_hist.assign(nbins, 0);
+  int* hist = m_hist.data();
+  for (int ind = 0; ind < n; ++ind) {
+    ++hist[bins[ind]];
+  }
+
+  // One pass over the cumulative counts for all fractions, in
+  // increasing order of their rank.
+  int order[8];
+  std::vector<int> big_order;
+  int* ord = order;
+  if (nfracs > 8) {
+    big_order.resize(nfracs);
+    ord = big_order.data();
+  }
+  for (int ifrac = 0; ifrac < nfracs; ++ifrac) {
+    ord[ifrac] = ifrac;
+  }
+  std::sort(ord, ord + nfracs, [&](int a, int b) { return fracs[a] < fracs[b]; });
+
+  const size_t nsamples = n;
+  int ibin = 0, count = hist[0];
+  for (int iord = 0; iord < nfracs; ++iord) {
+    const int ifrac = ord[iord];
+    const int imed = nsamples * fracs[ifrac];
+    while (count <= imed && ibin < nbins - 1) {
+      count += hist[++ibin];
+    }
+    out[ifrac] = count > imed ? vmin + ibin*binsize : 0.0f;
+  }
+}
+
+float RobustStats::percentile_rms(const float* data, int n, float* median)
+{
+  const float fracs[3] = {0.5 - 0.34, 0.5, 0.5 + 0.34};
+  float par[3];
+  percentiles(data, n, fracs, par, 3);
+  if (median) {
+    *median = par[1];
+  }
+  return sqrt((pow(par[2]-par[1],2)+pow(par[1]-par[0],2))/2.);
+}
+
+// Local Variables:
+// mode: c++
+// c-basic-offset: 2
+// End:
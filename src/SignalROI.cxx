@@ -1,19 +1,20 @@
 #include "SignalROI.h"
 
 #include <algorithm>
+#include <new>
 
 using namespace WireCell;
 using namespace WireCell::SigProc;
 
-SignalROI::SignalROI(int plane, int chid, int start_bin, int end_bin, const Waveform::realseq_t& signal)
+SignalROI::SignalROI(int plane, int chid, int start_bin, int end_bin, const Waveform::realseq_t& signal, float* samples)
   : plane(plane)
   , chid(chid)
   , start_bin(start_bin)
   , end_bin(end_bin)
+  , contents(samples, std::max(0, end_bin-start_bin+1))
 {
   float start_content = signal.at(start_bin);
   float end_content = signal.at(end_bin);
-  contents.resize(end_bin-start_bin+1);
   
   for (int i=start_bin; i<= end_bin; i++){
     float content = signal.at(i) - ((end_content - start_content)*(i-start_bin)/(end_bin-start_bin) + start_content);
@@ -21,13 +22,14 @@ SignalROI::SignalROI(int plane, int chid, int start_bin, int end_bin, const Wave
   }
 }
 
-SignalROI::SignalROI(SignalROI *roi){
+SignalROI::SignalROI(SignalROI *roi, float* samples){
   plane = roi->get_plane();
   chid = roi->get_chid();
   start_bin = roi->get_start_bin();
   end_bin = roi->get_end_bin();
+  contents = SignalROIContents(samples, roi->get_contents().size());
   for (int i=start_bin; i<=end_bin;i++){
-    contents.push_back(roi->get_contents().at(i-start_bin));
+    contents.at(i-start_bin) = roi->get_contents().at(i-start_bin);
   }
 }
 
@@ -53,7 +55,7 @@ bool SignalROI::overlap(SignalROI* roi1, float th, float th1){
   if (end_bin > roi1->get_end_bin())
     min_end_bin = roi1->get_end_bin();
   if (min_end_bin > min_start_bin){
-    std::vector<float>& contents1 = roi1->get_contents();
+    SignalROIContents& contents1 = roi1->get_contents();
 
     for (int i=min_start_bin; i<= min_end_bin; i++){
       if (contents.at(i-start_bin) > th && 
@@ -92,11 +94,6 @@ bool SignalROI::overlap(SignalROI* roi){
 
 
 
-SignalROI::~SignalROI(){
-}
-
-
-
 std::vector<std::pair<int,int>> SignalROI::get_above_threshold(float th){
   std::vector<std::pair<int,int>> bins;
   for (int i=0;i<int(contents.size());i++){
@@ -117,3 +114,83 @@ std::vector<std::pair<int,int>> SignalROI::get_above_threshold(float th){
 
   return bins;
 }
+
+
+// Blocks of this many ROIs and samples are added as a frame needs
+// them.  A ROI longer than a sample block gets a block of its own.
+static const size_t roi_block_size = 1024;
+static const size_t sample_block_size = 1<<16;
+
+SignalROIPool::SignalROIPool()
+  : m_nrois(0)
+  , m_next_id(0)
+  , m_sample_block(0)
+  , m_sample_used(0)
+  , m_last_nsamples(0)
+{
+}
+
+void* SignalROIPool::roi_slot(){
+  const size_t iblock = m_nrois / roi_block_size;
+  if (iblock == m_roi_blocks.size()){
+    m_roi_blocks.emplace_back(new roi_storage_t[roi_block_size]);
+  }
+  void* slot = &m_roi_blocks[iblock][m_nrois % roi_block_size];
+  ++m_nrois;
+  return slot;
+}
+
+float* SignalROIPool::sample_slot(size_t nsamples){
+  if (m_sample_block < m_sample_blocks.size() &&
+      m_sample_used + nsamples > m_sample_block_sizes[m_sample_block]){
+    ++m_sample_block;
+    m_sample_used = 0;
+  }
+  if (m_sample_block == m_sample_blocks.size() ||
+      m_sample_block_sizes[m_sample_block] < nsamples){
+    const size_t size = std::max(nsamples, sample_block_size);
+    m_sample_blocks.emplace(m_sample_blocks.begin() + m_sample_block, new float[size]);
+    m_sample_block_sizes.insert(m_sample_block_sizes.begin() + m_sample_block, size);
+  }
+  float* slot = m_sample_blocks[m_sample_block].get() + m_sample_used;
+  m_sample_used += nsamples;
+  m_last_nsamples = nsamples;
+  return slot;
+}
+
+SignalROI* SignalROIPool::make(int plane, int chid, int start_bin, int end_bin, const Waveform::realseq_t& signal){
+  float* samples = sample_slot(std::max(0, end_bin-start_bin+1));
+  SignalROI* roi = new (roi_slot()) SignalROI(plane, chid, start_bin, end_bin, signal, samples);
+  roi->id = m_next_id++;
+  return roi;
+}
+
+SignalROI* SignalROIPool::copy(SignalROI *roi){
+  float* samples = sample_slot(roi->get_contents().size());
+  SignalROI* ret = new (roi_slot()) SignalROI(roi, samples);
+  ret->id = m_next_id++;
+  return ret;
+}
+
+void SignalROIPool::release(SignalROI *roi){
+  if (m_nrois == 0){
+    return;
+  }
+  const size_t ilast = m_nrois - 1;
+  if (roi != (void*)&m_roi_blocks[ilast / roi_block_size][ilast % roi_block_size]){
+    return;
+  }
+  --m_nrois;
+  if (roi->get_contents().data() + m_last_nsamples == m_sample_blocks[m_sample_block].get() + m_sample_used){
+    m_sample_used -= m_last_nsamples;
+  }
+  m_last_nsamples = 0;
+}
+
+void SignalROIPool::clear(){
+  m_nrois = 0;
+  m_next_id = 0;
+  m_sample_block = 0;
+  m_sample_used = 0;
+  m_last_nsamples = 0;
+}
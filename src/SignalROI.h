@@ -3,7 +3,11 @@
 
 #include "WireCellUtil/Waveform.h"
 
+#include <deque>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
 #include <vector>
 #include <list>
 #include <map>
@@ -11,11 +15,37 @@
 
 namespace WireCell{
   namespace SigProc{
+
+    // The samples of a ROI.  They are held in the buffers of the
+    // SignalROIPool which made the ROI and have a fixed length.
+    class SignalROIContents{
+    public:
+      SignalROIContents() : m_data(0), m_size(0) {}
+      SignalROIContents(float* data, size_t size) : m_data(data), m_size(size) {}
+
+      size_t size() const {return m_size;}
+      float* data() {return m_data;}
+      float* begin() {return m_data;}
+      float* end() {return m_data + m_size;}
+      float& operator[](size_t ind) {return m_data[ind];}
+      float& at(size_t ind) {
+	if (ind >= m_size) {
+	  throw std::out_of_range("SignalROIContents::at");
+	}
+	return m_data[ind];
+      }
+
+    private:
+      float* m_data;
+      size_t m_size;
+    };
+
+    class SignalROIPool;
+
+    // A SignalROI is made by a SignalROIPool and lives until the
+    // pool is cleared or destroyed.
     class SignalROI{
     public:
-      SignalROI(int plane, int chid, int start_bin, int end_bin, const Waveform::realseq_t& signal);
-      SignalROI(SignalROI *roi);
-      ~SignalROI();
       int get_start_bin(){return start_bin;}
       int get_end_bin(){return end_bin;}
 
@@ -24,17 +54,24 @@ namespace WireCell{
 
       void set_ext_start_bin(int a){ext_start_bin = a;}
       void set_ext_end_bin(int a){ext_end_bin = a;}
-    
+
       int get_chid(){return chid;}
       int get_plane(){return plane;}
-      std::vector<float>& get_contents(){return contents;}
+      // number of the ROI in its pool, not reused until the pool is cleared
+      int get_id(){return id;}
+      SignalROIContents& get_contents(){return contents;}
       std::vector<std::pair<int,int>> get_above_threshold(float th);
       double get_average_heights();
-      
+
       bool overlap(SignalROI *roi);
       bool overlap(SignalROI *roi1, float th, float th1);
-      
+
     private:
+      friend class SignalROIPool;
+      SignalROI(int plane, int chid, int start_bin, int end_bin, const Waveform::realseq_t& signal, float* samples);
+      SignalROI(SignalROI *roi, float* samples);
+
+      int id;
       int plane;
       int chid;
       int start_bin;
@@ -42,23 +79,108 @@ namespace WireCell{
 
       int ext_start_bin;
       int ext_end_bin;
- 
-      
-      std::vector<float> contents;
+
+
+      SignalROIContents contents;
     };
-    
-    typedef std::list<SignalROI*>SignalROIList;
-    typedef std::vector<SignalROI*> SignalROISelection; 
+
+    // Makes the SignalROIs of one frame.  The ROIs and their samples
+    // are placed in blocks owned by the pool so making one costs no
+    // allocation once the blocks exist.  A ROI is not freed on its
+    // own: all are dropped together by clear(), which keeps the
+    // blocks for the next frame, or when the pool is destroyed.
+    class SignalROIPool{
+    public:
+      SignalROIPool();
+
+      // Make a ROI of signal over [start_bin, end_bin].
+      SignalROI* make(int plane, int chid, int start_bin, int end_bin, const Waveform::realseq_t& signal);
+      // Make a copy of a ROI.
+      SignalROI* copy(SignalROI *roi);
+      // Give back the space of a ROI no longer used.  Only the most
+      // recently made ROI is actually reused, others wait for clear().
+      void release(SignalROI *roi);
+      // Drop all ROIs.
+      void clear();
+
+      // Number of ROIs made since the last clear().
+      size_t size() const {return m_nrois;}
+
+    private:
+      typedef std::aligned_storage<sizeof(SignalROI), alignof(SignalROI)>::type roi_storage_t;
+
+      void* roi_slot();
+      float* sample_slot(size_t nsamples);
+
+      std::vector<std::unique_ptr<roi_storage_t[]>> m_roi_blocks;
+      size_t m_nrois;
+      int m_next_id;
+
+      std::vector<std::unique_ptr<float[]>> m_sample_blocks;
+      std::vector<size_t> m_sample_block_sizes;
+      size_t m_sample_block;    // block now being filled
+      size_t m_sample_used;     // samples used in that block
+      size_t m_last_nsamples;   // samples of the most recently made ROI
+    };
+
+    typedef std::vector<SignalROI*> SignalROIList;
+    typedef std::vector<SignalROI*> SignalROISelection;
     typedef std::vector<SignalROISelection> SignalROIChSelection;
     typedef std::vector<SignalROIList> SignalROIChList;
     typedef std::map<SignalROI*, SignalROISelection> SignalROIMap;
 
+    // A list of ROIs for each ROI of a pool, such as its neighbours on
+    // the next wire.  It stands in for a SignalROIMap: a ROI's list is
+    // found by the ROI's id rather than by a tree search, and has()
+    // tells if operator[] was used for the ROI since it was last
+    // erased, as find() on the map would.  Erased lists and all lists
+    // at clear() are only marked stale and keep their space.  As with
+    // the map, a reference to a list stays valid while others are
+    // added.
+    class SignalROILinks{
+    public:
+      SignalROILinks() : m_epoch(1) {}
+
+      bool has(SignalROI *roi) const {
+	const size_t id = roi->get_id();
+	return id < m_slots.size() && m_slots[id].epoch == m_epoch;
+      }
+      SignalROISelection& operator[](SignalROI *roi) {
+	const size_t id = roi->get_id();
+	if (id >= m_slots.size()) {
+	  m_slots.resize(id + 1);
+	}
+	Slot& slot = m_slots[id];
+	if (slot.epoch != m_epoch) {
+	  slot.rois.clear();
+	  slot.epoch = m_epoch;
+	}
+	return slot.rois;
+      }
+      void erase(SignalROI *roi) {
+	if (has(roi)) {
+	  m_slots[roi->get_id()].epoch = 0;
+	}
+      }
+      void clear() {
+	++m_epoch;
+      }
+
+    private:
+      struct Slot {
+	SignalROISelection rois;
+	unsigned int epoch = 0;
+      };
+      std::deque<Slot> m_slots; // keeps lists in place as it grows
+      unsigned int m_epoch;
+    };
+
     struct CompareRois{
       bool operator() (SignalROI* roi1, SignalROI* roi2) const{
-	return roi1->get_start_bin() < roi2->get_start_bin(); 
+	return roi1->get_start_bin() < roi2->get_start_bin();
       }
     };
-    
+
   }
 }
 
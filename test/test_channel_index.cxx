@@ -0,0 +1,56 @@
+// Check a ChannelIndex against the anode's own geometry.
+
+#include "WireCellSigProc/ChannelIndex.h"
+
+#include "WireCellUtil/Testing.h"
+#include "WireCellUtil/NamedFactory.h"
+#include "WireCellIface/IAnodePlane.h"
+
+#include <iostream>
+#include <string>
+
+#include "anode_loader.h"       // do not use this
+
+using namespace WireCell;
+using namespace WireCell::SigProc;
+using namespace std;
+
+int main(int argc, char* argv[])
+{
+  std::string detector = "uboone";
+  if (argc > 1) {
+    detector = argv[1];
+  }
+  auto anode_tns = anode_loader(detector);
+
+  for (auto anode_tn : anode_tns) {
+    auto anode = Factory::find_tn<IAnodePlane>(anode_tn);
+    auto index = ChannelIndex::get(anode);
+    Assert(index == ChannelIndex::get(anode)); // shared
+
+    // planes are contiguous and in order
+    int nchans = 0;
+    for (int iplane = 0; iplane < 3; ++iplane) {
+      Assert(index->first(iplane) == nchans);
+      nchans += index->nwires(iplane);
+    }
+    Assert(nchans == index->size());
+
+    for (int ind = 0; ind < index->size(); ++ind) {
+      const int ident = index->ident(ind);
+      Assert(index->plane(ind) == anode->resolve(ident).index());
+      Assert(index->plane_of(ident) == index->plane(ind));
+      Assert(index->ident(index->index(ident)) == ident);
+      Assert(index->wire(ind) == ind - index->first(index->plane(ind)));
+    }
+    for (auto ident : anode->channels()) {
+      Assert(index->index(ident) >= 0);
+    }
+    Assert(index->index(-1) == -1);
+    Assert(index->plane_of(-1) == -1);
+
+    cerr << anode_tn << ": " << index->size() << " channels, "
+         << index->nwires(0) << "/" << index->nwires(1) << "/" << index->nwires(2) << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,92 @@
+// Check that an FFTEngine gives the same results as the free
+// functions in WireCellUtil/Array.h and that it survives reuse.
+
+#include "WireCellSigProc/FFTEngine.h"
+#include "WireCellUtil/Array.h"
+#include "WireCellUtil/Testing.h"
+
+#include <iostream>
+#include <string>
+
+using namespace WireCell;
+using namespace WireCell::SigProc;
+
+int main()
+{
+  Assert(FFTEngine::known("eigen"));
+  Assert(FFTEngine::known("eigen-blocked"));
+
+  // unknown backends fall back to eigen
+  Assert(FFTEngine::make("no-such-backend", 2, 2)->backend() == "eigen");
+
+  // odd and even sizes take different paths in the FFT, the last is
+  // bigger than a transpose block
+  const int shapes[][2] = { {7,10}, {16,33}, {50,64}, {70,131} };
+  for (std::string backend : {"eigen", "eigen-blocked"}) {
+  for (auto shape : shapes) {
+    const int nrows = shape[0], ncols = shape[1];
+
+    auto engine = FFTEngine::make(backend, nrows, ncols);
+    Assert(engine->backend() == backend);
+
+    Array::array_xxc cdata;
+    Array::array_xxf rdata;
+    for (int itry = 0; itry < 2; ++itry) { // second time reuses plans
+      const Array::array_xxf arr = Array::array_xxf::Random(nrows, ncols);
+
+      Array::array_xxc want = Array::dft_rc(arr, 0);
+      engine->fwd_rows(arr, cdata);
+      Assert((cdata == want).all());
+
+      want = Array::dft_cc(want, 1);
+      engine->fwd_cols(cdata);
+      Assert((cdata == want).all());
+
+      want = Array::idft_cc(want, 1);
+      engine->inv_cols(cdata);
+      Assert((cdata == want).all());
+
+      const Array::array_xxf back = Array::idft_cr(want, 0);
+      engine->inv_rows(cdata, rdata);
+      Assert((rdata == back).all());
+
+      for (int irow = 0; irow < nrows; ++irow) {
+        const Eigen::VectorXcf spec = cdata.row(irow).transpose();
+        Eigen::VectorXf wave;
+        engine->inv_row(spec, wave);
+        Assert((wave.transpose().array() == back.row(irow)).all());
+      }
+
+      // half spectra are the leading columns of the full ones
+      Array::array_xxc half;
+      engine->fwd_rows_half(arr, half);
+      Assert(half.cols() == engine->nhalf());
+      Assert((half == Array::dft_rc(arr, 0).leftCols(engine->nhalf())).all());
+      for (int irow = 0; irow < nrows; ++irow) {
+        const Eigen::VectorXcf spec = half.row(irow).transpose();
+        Eigen::VectorXf wave;
+        engine->inv_row_half(spec, wave);
+        Assert((wave.transpose().array() - arr.row(irow)).abs().maxCoeff() < 1e-5);
+      }
+
+      const float maxdiff = (rdata - arr).abs().maxCoeff();
+      std::cerr << backend << " " << nrows << "x" << ncols << " round trip max diff: " << maxdiff << "\n";
+      Assert(maxdiff < 1e-5);
+    }
+  }
+  }
+
+  // a wrong shape must throw
+  auto engine = FFTEngine::make("eigen", 4, 4);
+  Array::array_xxc cdata;
+  bool threw = false;
+  try {
+    engine->fwd_rows(Array::array_xxf::Zero(4,5), cdata);
+  }
+  catch (...) {
+    threw = true;
+  }
+  Assert(threw);
+
+  return 0;
+}
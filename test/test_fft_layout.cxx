@@ -0,0 +1,75 @@
+// Benchmark the FFTEngine backends on a plane of DUNE-like size with
+// the sequence of transforms made by the OSP 2D decon and check that
+// they agree.  The backends only differ in the forward time pass as
+// the OSP does its time inverse a row at a time.
+//
+//   test_fft_layout [nwires [nticks [ntries]]]
+
+#include "WireCellSigProc/FFTEngine.h"
+#include "WireCellUtil/Testing.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace WireCell;
+using namespace WireCell::SigProc;
+
+int main(int argc, char* argv[])
+{
+  int nwires = 960, nticks = 6000, ntries = 3;
+  if (argc > 1) { nwires = atoi(argv[1]); }
+  if (argc > 2) { nticks = atoi(argv[2]); }
+  if (argc > 3) { ntries = atoi(argv[3]); }
+
+  const Array::array_xxf data = Array::array_xxf::Random(nwires, nticks);
+
+  std::vector<Array::array_xxf> results;
+  for (std::string backend : {"eigen", "eigen-blocked"}) {
+    auto engine = FFTEngine::make(backend, nwires, nticks);
+    Array::array_xxc cdata;
+    Array::array_xxf result(nwires, nticks);
+    Eigen::VectorXcf spec;
+    Eigen::VectorXf wave;
+
+    double best[3] = {-1, -1, -1};
+    for (int itry = 0; itry < ntries; ++itry) {
+      typedef std::chrono::steady_clock clock;
+      const auto t0 = clock::now();
+      engine->fwd_rows_half(data, cdata);
+      const auto t1 = clock::now();
+      engine->fwd_cols(cdata);
+      engine->inv_cols(cdata);
+      const auto t2 = clock::now();
+      for (int irow = 0; irow < nwires; ++irow) {
+        spec = cdata.row(irow).transpose();
+        engine->inv_row_half(spec, wave);
+        result.row(irow) = wave.transpose().array();
+      }
+      const auto t3 = clock::now();
+      const double dts[3] = {
+        std::chrono::duration<double>(t1-t0).count(),
+        std::chrono::duration<double>(t2-t1).count(),
+        std::chrono::duration<double>(t3-t2).count()
+      };
+      for (int ind = 0; ind < 3; ++ind) {
+        if (best[ind] < 0 || dts[ind] < best[ind]) {
+          best[ind] = dts[ind];
+        }
+      }
+    }
+    std::cerr << backend << " " << nwires << "x" << nticks
+              << ": time fwd " << best[0]*1e3 << " ms"
+              << ", wire fwd+inv " << best[1]*1e3 << " ms"
+              << ", time inv " << best[2]*1e3 << " ms\n";
+    results.push_back(result);
+  }
+
+  // the layout does not change the numbers
+  Assert((results[0] == results[1]).all());
+  Assert((results[0] - data).abs().maxCoeff() < 1e-4);
+
+  return 0;
+}
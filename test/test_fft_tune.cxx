@@ -0,0 +1,66 @@
+// Time FFT lengths and report the fastest in a range.
+//
+//   test_fft_tune [nmin [nmax [backend [table.json]]]]
+//
+// The default range is around a typical MicroBooNE readout.  Giving
+// a table file keeps the timings, which OmnibusSigProc can then use
+// with fft_flag=2 and fft_table set to the same file.
+
+#include "WireCellSigProc/FFTLengthTuner.h"
+
+#include "WireCellUtil/FFTBestLength.h"
+#include "WireCellUtil/Testing.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace WireCell;
+using namespace WireCell::SigProc;
+
+int main(int argc, char* argv[])
+{
+  int nmin = 9592;
+  if (argc > 1) {
+    nmin = atoi(argv[1]);
+  }
+  int nmax = nmin + nmin/10;
+  if (argc > 2) {
+    nmax = atoi(argv[2]);
+  }
+  std::string backend = "eigen";
+  if (argc > 3) {
+    backend = argv[3];
+  }
+  std::string filename = "";
+  if (argc > 4) {
+    filename = argv[4];
+  }
+
+  const auto cands = FFTLengthTuner::candidates(nmin, nmax);
+  Assert(cands.front() == nmin);
+  Assert(cands.back() == nmax);
+
+  FFTLengthTuner tuner(backend, filename);
+  const int best = tuner.best_length(nmin, nmax);
+  Assert(nmin <= best && best <= nmax);
+
+  for (int n : cands) {
+    const double t = tuner.time(n);
+    Assert(t > 0);
+    Assert(t >= tuner.time(best));
+    std::cerr << n << "\t" << t*1e6 << " us" << (n == best ? "\t<-- best" : "") << "\n";
+  }
+  const int guess = fft_best_length(nmin);
+  std::cerr << tuner.key() << ": best length for " << nmin << " is " << best
+            << ", fft_best_length() gives " << guess << "\n";
+
+  // a second tuner sees the saved table
+  if (!filename.empty()) {
+    FFTLengthTuner again(backend, filename);
+    Assert(std::abs(again.time(best) - tuner.time(best)) <= 1e-6*tuner.time(best));
+    Assert(again.best_length(nmin, nmax) == best);
+  }
+  return 0;
+}
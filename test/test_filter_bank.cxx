@@ -0,0 +1,72 @@
+#include "WireCellSigProc/FilterBank.h"
+
+#include "WireCellUtil/Units.h"
+#include "WireCellUtil/Testing.h"
+
+/// needed to pretend like we are doing WCT internals
+#include "WireCellUtil/PluginManager.h"
+#include "WireCellUtil/NamedFactory.h"
+#include "WireCellIface/IFilterWaveform.h"
+#include "WireCellIface/IConfigurable.h"
+
+using namespace WireCell;
+
+int main(int argc, char* argv[])
+{
+  PluginManager& pm = PluginManager::instance();
+  pm.add("WireCellSigProc");
+
+  {
+    auto incrcfg = Factory::lookup<IConfigurable>("LfFilter","lf1");
+    auto cfg = incrcfg->default_configuration();
+    cfg["max_freq"] = 1 * units::megahertz;
+    cfg["tau"] = 0.02 * units::megahertz;
+    incrcfg->configure(cfg);
+  }
+  {
+    auto incrcfg = Factory::lookup<IConfigurable>("HfFilter","hf1");
+    auto cfg = incrcfg->default_configuration();
+    cfg["max_freq"] = 1 * units::megahertz;
+    cfg["sigma"] = 4 * units::megahertz;
+    cfg["power"] = 2;
+    cfg["flag"] = true;
+    incrcfg->configure(cfg);
+  }
+
+  SigProc::FilterBank bank;
+  const int lf = bank.filter("LfFilter","lf1");
+  const int hf = bank.filter("HfFilter","hf1");
+  Assert(lf != hf);
+  Assert(bank.filter("LfFilter","lf1") == lf);
+  const int both = bank.product(hf, lf);
+  Assert(bank.product(hf, lf) == both);
+
+  const int nbins = 100;
+  auto want_lf = Factory::find<IFilterWaveform>("LfFilter","lf1")->filter_waveform(nbins);
+  auto want_hf = Factory::find<IFilterWaveform>("HfFilter","hf1")->filter_waveform(nbins);
+
+  const Waveform::realseq_t& got_lf = bank.spectrum(lf, nbins);
+  const Waveform::realseq_t& got_hf = bank.spectrum(hf, nbins);
+  const Waveform::realseq_t& got_both = bank.spectrum(both, nbins);
+  Assert(got_lf == want_lf);
+  Assert(got_hf == want_hf);
+  for (int ind=0; ind<nbins; ++ind) {
+    Assert(got_both[ind] == want_hf[ind]*want_lf[ind]);
+  }
+
+  // memoized: same object, and other sizes do not disturb it
+  Assert(&bank.spectrum(lf, nbins) == &got_lf);
+  Assert((int)bank.spectrum(lf, 2*nbins).size() == 2*nbins);
+  Assert(&bank.spectrum(lf, nbins) == &got_lf);
+
+  bool threw = false;
+  try {
+    bank.filter("HfFilter","no-such-filter");
+  }
+  catch (...) {
+    threw = true;
+  }
+  Assert(threw);
+
+  return 0;
+}
@@ -20,7 +20,8 @@ using namespace WireCell::SigProc;
 
 int main(int argc, char* argv[])
 {
-    Microboone::SignalFilter(horig);
-    bool is_noisy = Microboone::NoisyFilterAlg(horig,0.7,10.0);
+    RobustStats stats;
+    Microboone::SignalFilter(horig, stats);
+    bool is_noisy = Microboone::NoisyFilterAlg(horig,0.7,10.0,stats);
     Assert(is_noisy);
 }
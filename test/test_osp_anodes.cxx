@@ -0,0 +1,142 @@
+// Run a multi-anode OmnibusSigProc on frames covering only some of
+// its anodes and check the merged output.
+//
+//   test_osp_anodes [nticks]
+
+#include "WireCellUtil/Testing.h"
+#include "WireCellUtil/NamedFactory.h"
+#include "WireCellIface/IFrameFilter.h"
+#include "WireCellIface/IConfigurable.h"
+#include "WireCellIface/IAnodePlane.h"
+#include "WireCellIface/SimpleFrame.h"
+#include "WireCellIface/SimpleTrace.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "anode_loader.h"       // do not use this
+
+using namespace WireCell;
+using namespace std;
+
+static void configure_filter(const std::string& type, const std::string& name)
+{
+  auto icfg = Factory::lookup<IConfigurable>(type, name);
+  icfg->configure(icfg->default_configuration());
+}
+
+// A frame starting at tbin with a pulse on every channel of the given
+// anodes and the first of those channels marked bad at both ends,
+// past the ends of the readout.
+static IFrame::pointer make_frame(int ident, const std::vector<IAnodePlane::pointer>& anodes, int nticks, int tbin = 0)
+{
+  ITrace::vector traces;
+  Waveform::ChannelMaskMap cmm;
+  for (auto anode : anodes) {
+    auto& bad = cmm["bad"][anode->channels().front()];
+    bad.push_back(Waveform::BinRange(tbin - 10, tbin + 10));
+    bad.push_back(Waveform::BinRange(tbin + nticks - 5, tbin + nticks + 20));
+    for (auto ch : anode->channels()) {
+      ITrace::ChargeSequence charge(nticks, 0.0);
+      for (int tick = nticks/2; tick < nticks/2 + 10; ++tick) {
+        charge[tick] = 100.0;
+      }
+      traces.push_back(std::make_shared<SimpleTrace>(ch, tbin, charge));
+    }
+  }
+  return std::make_shared<SimpleFrame>(ident, 0, traces, 0.5*units::microsecond, cmm);
+}
+
+// All output traces are on channels of the given anodes, the tags
+// point inside the frame and the bad masks are those of make_frame()
+// keyed by channel ident.
+static void check(IFrame::pointer out, const std::vector<IAnodePlane::pointer>& anodes)
+{
+  Assert(out);
+  std::set<int> chans;
+  for (auto anode : anodes) {
+    for (auto ch : anode->channels()) {
+      chans.insert(ch);
+    }
+  }
+  auto traces = out->traces();
+  for (auto trace : *traces) {
+    Assert(chans.count(trace->channel()));
+  }
+  for (std::string tag : {"wiener", "gauss"}) {
+    for (auto ind : out->tagged_traces(tag)) {
+      Assert(ind < traces->size());
+    }
+  }
+  Assert(out->trace_summary("threshold").size() == out->tagged_traces("wiener").size());
+  auto masks = out->masks();
+  Assert(masks["bad"].size() == anodes.size());
+  for (auto anode : anodes) {
+    Assert(masks["bad"].count(anode->channels().front()));
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int nticks = 1000;
+  if (argc > 1) { nticks = atoi(argv[1]); }
+
+  auto anode_tns = anode_loader("protodune-larsoft");
+  std::vector<IAnodePlane::pointer> anodes;
+  for (auto tn : anode_tns) {
+    anodes.push_back(Factory::find_tn<IAnodePlane>(tn));
+  }
+  Assert(anodes.size() >= 3);
+
+  for (std::string name : {"ROI_tight_lf", "ROI_tighter_lf", "ROI_loose_lf"}) {
+    configure_filter("LfFilter", name);
+  }
+  for (std::string name : {"Gaus_wide", "Wire_ind", "Wire_col",
+        "Wiener_tight_U", "Wiener_tight_V", "Wiener_tight_W",
+        "Wiener_wide_U", "Wiener_wide_V", "Wiener_wide_W"}) {
+    configure_filter("HfFilter", name);
+  }
+
+  auto icfg = Factory::lookup<IConfigurable>("OmnibusSigProc");
+  auto cfg = icfg->default_configuration();
+  for (int ind = 0; ind < 3; ++ind) {
+    cfg["anodes"][ind] = anode_tns[ind];
+  }
+  cfg["nthreads"] = 3;
+  icfg->configure(cfg);
+  auto osp = Factory::find<IFrameFilter>("OmnibusSigProc");
+
+  // one anode, two of three, all, none
+  const std::vector<std::vector<IAnodePlane::pointer>> covers = {
+    {anodes[0]}, {anodes[0], anodes[2]}, {anodes[0], anodes[1], anodes[2]}, {}
+  };
+  int ident = 0;
+  for (const auto& cover : covers) {
+    IFrame::pointer out;
+    Assert((*osp)(make_frame(ident++, cover, nticks), out));
+    check(out, cover);
+    cerr << cover.size() << " anodes: " << out->traces()->size() << " traces\n";
+  }
+
+  // a frame not starting at tick 0
+  {
+    IFrame::pointer out;
+    Assert((*osp)(make_frame(ident++, {anodes[1]}, nticks, 100), out));
+    check(out, {anodes[1]});
+    for (auto trace : *out->traces()) {
+      Assert(trace->tbin() >= 100);
+    }
+  }
+
+  // traces from an anode not handled are dropped
+  {
+    IFrame::pointer out;
+    Assert((*osp)(make_frame(ident++, {anodes[3]}, nticks), out));
+    Assert(out->traces()->empty());
+    Assert(out->masks()["bad"].empty());
+  }
+  return 0;
+}
@@ -0,0 +1,86 @@
+// Check RobustStats against the Waveform percentile functions it
+// replaces and time the two.
+//
+//   test_robust_stats [nsamples [ntries]]
+
+#include "WireCellSigProc/RobustStats.h"
+
+#include "WireCellUtil/Waveform.h"
+#include "WireCellUtil/Testing.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+using namespace WireCell;
+using namespace WireCell::SigProc;
+
+static void check(RobustStats& stats, Waveform::realseq_t wave)
+{
+  const float fracs[5] = {0.5 + 0.34, 0.5, 0.5 - 0.34, 0.0, 0.99};
+  float got[5];
+  stats.percentiles(wave.data(), wave.size(), fracs, got, 5);
+  for (int ind = 0; ind < 5; ++ind) {
+    const float want = Waveform::percentile_binned(wave, fracs[ind]);
+    if (got[ind] != want) {
+      std::cerr << "n=" << wave.size() << " frac=" << fracs[ind]
+                << " got " << got[ind] << " want " << want << "\n";
+    }
+    Assert(got[ind] == want);
+  }
+  Assert(stats.median(wave.data(), wave.size()) == Waveform::median_binned(wave));
+}
+
+int main(int argc, char* argv[])
+{
+  int nsamples = 9592, ntries = 100;
+  if (argc > 1) { nsamples = atoi(argv[1]); }
+  if (argc > 2) { ntries = atoi(argv[2]); }
+
+  RobustStats stats;
+  std::mt19937 rng(42);
+  std::normal_distribution<float> noise(0.0, 3.0);
+
+  // noise with and without signal, ADC like integers, tiny and
+  // constant waveforms
+  for (int n : {1, 2, 3, 10, 101, nsamples}) {
+    Waveform::realseq_t wave(n);
+    for (auto& val : wave) { val = noise(rng); }
+    check(stats, wave);
+    for (int ind = 0; ind < n; ind += 7) { wave[ind] += 500; }
+    check(stats, wave);
+    for (auto& val : wave) { val = std::round(val); }
+    check(stats, wave);
+    wave.assign(n, 2.5);
+    check(stats, wave);
+  }
+
+  // an empty span gives zero
+  Assert(stats.median(nullptr, 0) == 0);
+
+  // timing of the three percentiles of an RMS estimate
+  Waveform::realseq_t wave(nsamples);
+  for (auto& val : wave) { val = noise(rng); }
+  typedef std::chrono::steady_clock clock;
+  float sum1 = 0, sum2 = 0;
+  auto t0 = clock::now();
+  for (int itry = 0; itry < ntries; ++itry) {
+    sum1 += stats.percentile_rms(wave.data(), wave.size());
+  }
+  auto t1 = clock::now();
+  for (int itry = 0; itry < ntries; ++itry) {
+    const float p0 = Waveform::percentile_binned(wave, 0.5 - 0.34);
+    const float p1 = Waveform::percentile_binned(wave, 0.5);
+    const float p2 = Waveform::percentile_binned(wave, 0.5 + 0.34);
+    const float rms = sqrt((pow(p2-p1,2)+pow(p1-p0,2))/2.);
+    sum2 += rms;
+  }
+  auto t2 = clock::now();
+  Assert(sum1 == sum2);
+  std::cerr << "percentile RMS of " << nsamples << " samples: RobustStats "
+            << std::chrono::duration<double>(t1-t0).count()/ntries*1e6 << " us, Waveform "
+            << std::chrono::duration<double>(t2-t1).count()/ntries*1e6 << " us\n";
+  return 0;
+}